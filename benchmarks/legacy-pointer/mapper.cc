@@ -0,0 +1,161 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  mapper.cc
+ *
+ *  Description:
+ *   Microbenchmarks of the legacy pointer PointerMapper
+ *
+ **************************************************************************/
+
+#include "benchmark/benchmark.h"
+
+#include <CL/sycl.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "legacy-pointer/legacy_pointer.hpp"
+
+using sycl_acc_mode = cl::sycl::access::mode;
+const sycl_acc_mode sycl_acc_rw = sycl_acc_mode::read_write;
+
+using namespace codeplay;
+
+using buffer_id = legacy::PointerMapper::buffer_id;
+
+/* Size in bytes of every allocation of the live set. */
+const size_t allocSize = 256;
+
+/* Allocates numPtrs live allocations with the legacy malloc and returns
+ * a randomly shuffled list of pointers into them. */
+std::vector<void *> make_live_set(size_t numPtrs) {
+  std::vector<void *> ptrs(numPtrs);
+  for (auto &ptr : ptrs) {
+    ptr = static_cast<uint8_t *>(legacy::malloc(allocSize)) + allocSize / 2;
+  }
+  std::shuffle(ptrs.begin(), ptrs.end(), std::default_random_engine{});
+  return ptrs;
+}
+
+/* Frees the live set created by make_live_set. */
+void free_live_set(const std::vector<void *> &ptrs) {
+  for (auto ptr : ptrs) {
+    legacy::free(ptr);
+  }
+}
+
+/* Latency of legacy::malloc with the given number of live allocations. */
+static void BM_legacy_malloc(benchmark::State &state) {
+  auto live = make_live_set(state.range(0));
+  for (auto _ : state) {
+    void *ptr = legacy::malloc(allocSize);
+    benchmark::DoNotOptimize(ptr);
+    state.PauseTiming();
+    legacy::free(ptr);
+    state.ResumeTiming();
+  }
+  free_live_set(live);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_legacy_malloc)->RangeMultiplier(8)->Range(1, 1 << 12);
+
+/* Latency of legacy::free with the given number of live allocations. */
+static void BM_legacy_free(benchmark::State &state) {
+  auto live = make_live_set(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    void *ptr = legacy::malloc(allocSize);
+    state.ResumeTiming();
+    legacy::free(ptr);
+  }
+  free_live_set(live);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_legacy_free)->RangeMultiplier(8)->Range(1, 1 << 12);
+
+/* Latency of get_offset on random pointers of the live set. */
+static void BM_legacy_get_offset(benchmark::State &state) {
+  auto live = make_live_set(state.range(0));
+  auto &pMap = legacy::getPointerMapper();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(pMap.get_offset(live[i]));
+    i = (i + 1 == live.size()) ? 0 : i + 1;
+  }
+  free_live_set(live);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_legacy_get_offset)->RangeMultiplier(8)->Range(1, 1 << 12);
+
+/* Latency of get_buffer (including the buffer id extraction) on random
+ * pointers of the live set. */
+static void BM_legacy_get_buffer(benchmark::State &state) {
+  auto live = make_live_set(state.range(0));
+  auto &pMap = legacy::getPointerMapper();
+  size_t i = 0;
+  for (auto _ : state) {
+    auto b = pMap.get_buffer(pMap.get_buffer_id(live[i]));
+    benchmark::DoNotOptimize(b);
+    i = (i + 1 == live.size()) ? 0 : i + 1;
+  }
+  free_live_set(live);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_legacy_get_buffer)->RangeMultiplier(8)->Range(1, 1 << 12);
+
+/* Cost of submitting an empty command group, the baseline for
+ * BM_legacy_get_access. */
+static void BM_legacy_submit(benchmark::State &state) {
+  cl::sycl::queue q;
+  for (auto _ : state) {
+    q.submit([&](cl::sycl::handler &h) {
+      h.single_task<class legacy_submit>([=]() {});
+    });
+  }
+  q.wait();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_legacy_submit);
+
+/* Latency of submitting a command group that obtains a device accessor
+ * from a random pointer of the live set. Subtract BM_legacy_submit to
+ * obtain the cost of the lookup and the accessor creation. */
+static void BM_legacy_get_access(benchmark::State &state) {
+  auto live = make_live_set(state.range(0));
+  auto &pMap = legacy::getPointerMapper();
+  cl::sycl::queue q;
+  size_t i = 0;
+  for (auto _ : state) {
+    q.submit([&](cl::sycl::handler &h) {
+      auto b = pMap.get_buffer(pMap.get_buffer_id(live[i]));
+      auto acc = b.get_access<sycl_acc_rw>(h);
+      h.single_task<class legacy_get_access>([=]() { (void)acc; });
+    });
+    i = (i + 1 == live.size()) ? 0 : i + 1;
+  }
+  q.wait();
+  free_live_set(live);
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_legacy_get_access)->RangeMultiplier(8)->Range(1, 1 << 12);
+
+BENCHMARK_MAIN();
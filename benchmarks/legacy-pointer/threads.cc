@@ -0,0 +1,90 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  threads.cc
+ *
+ *  Description:
+ *   Scalability of the thread-local legacy pointer mappers
+ *
+ **************************************************************************/
+
+#define CODEPLAY_LEGACY_THREAD_LOCAL
+
+#include "benchmark/benchmark.h"
+
+#include <CL/sycl.hpp>
+
+#include <vector>
+
+#include "legacy-pointer/legacy_pointer.hpp"
+
+using namespace codeplay;
+
+/* Size in bytes of every allocation. */
+const size_t allocSize = 256;
+
+/* Number of allocations kept alive by each thread. */
+const size_t numLive = 64;
+
+/* Throughput of malloc/free pairs issued concurrently from several
+ * threads, each one allocating from its own mapper. */
+static void BM_legacy_threads_malloc_free(benchmark::State &state) {
+  std::vector<void *> live(numLive, nullptr);
+  size_t i = 0;
+  for (auto _ : state) {
+    auto &ptr = live[i];
+    if (ptr != nullptr) {
+      legacy::free(ptr);
+    }
+    ptr = legacy::malloc(allocSize);
+    benchmark::DoNotOptimize(ptr);
+    i = (i + 1 == numLive) ? 0 : i + 1;
+  }
+  for (auto ptr : live) {
+    if (ptr != nullptr) {
+      legacy::free(ptr);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_legacy_threads_malloc_free)->ThreadRange(1, 16)->UseRealTime();
+
+/* Throughput of buffer lookups issued concurrently from several threads
+ * on pointers allocated by each of them. */
+static void BM_legacy_threads_get_buffer(benchmark::State &state) {
+  std::vector<void *> live(numLive);
+  for (auto &ptr : live) {
+    ptr = legacy::malloc(allocSize);
+  }
+  auto &pMap = legacy::getPointerMapper();
+  size_t i = 0;
+  for (auto _ : state) {
+    auto b = pMap.get_buffer(pMap.get_buffer_id(live[i]));
+    benchmark::DoNotOptimize(b);
+    i = (i + 1 == numLive) ? 0 : i + 1;
+  }
+  for (auto ptr : live) {
+    legacy::free(ptr);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_legacy_threads_get_buffer)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,182 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  reduction.cc
+ *
+ *  Description:
+ *   Throughput and small input latency of the reduction algorithms of the
+ *   reduction sample, and of fused and separate reductions of statistics
+ *
+ **************************************************************************/
+
+#include "benchmark/benchmark.h"
+
+#include <CL/sycl.hpp>
+
+#include <functional>
+#include <vector>
+
+#include "reduction.hpp"
+
+using reduce_t = float (*)(cl::sycl::queue&, cl::sycl::buffer<float, 1>&);
+
+/* Throughput of the given reduction algorithm for a sum of the number of
+ * elements given by the range. The same buffer is reduced at every
+ * iteration, and the result is read back on the host. */
+void reduce_buffer(benchmark::State& state, reduce_t reduce_op) {
+  const size_t nElems = state.range(0);
+  std::vector<float> hostData(nElems, 1.0f);
+  cl::sycl::queue q;
+  cl::sycl::buffer<float, 1> buf(hostData.data(), cl::sycl::range<1>{nElems});
+  buf.set_final_data(nullptr);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(reduce_op(q, buf));
+  }
+  state.SetItemsProcessed(state.iterations() * nElems);
+  state.SetBytesProcessed(state.iterations() * nElems * sizeof(float));
+}
+
+/* Reduction with one kernel launch per level, every level reading the
+ * partial results of the previous one from global memory. */
+static void BM_reduce(benchmark::State& state) {
+  reduce_buffer(state, reduce<float, std::plus<float>>);
+}
+BENCHMARK(BM_reduce)
+    ->RangeMultiplier(16)
+    ->Range(1 << 10, 1 << 26)
+    ->Arg(100000000)
+    ->Unit(benchmark::kMicrosecond);
+
+/* Reduction in two launches, the first one accumulating a grid-stride share
+ * of the input in every work-item. */
+static void BM_reduce_grid_stride(benchmark::State& state) {
+  reduce_buffer(state, reduce_grid_stride<float, std::plus<float>>);
+}
+BENCHMARK(BM_reduce_grid_stride)
+    ->RangeMultiplier(16)
+    ->Range(1 << 10, 1 << 26)
+    ->Arg(100000000)
+    ->Unit(benchmark::kMicrosecond);
+
+/* Latency of small reductions, for the number of elements given by the
+ * range, when every call constructs its own queue, as the original
+ * reduction sample did. */
+static void BM_reduce_latency_new_queue(benchmark::State& state) {
+  const size_t nElems = state.range(0);
+  std::vector<float> hostData(nElems, 1.0f);
+  cl::sycl::buffer<float, 1> buf(hostData.data(), cl::sycl::range<1>{nElems});
+  buf.set_final_data(nullptr);
+  for (auto _ : state) {
+    cl::sycl::queue q;
+    benchmark::DoNotOptimize(
+        reduce_grid_stride<float, std::plus<float>>(q, buf));
+  }
+}
+BENCHMARK(BM_reduce_latency_new_queue)
+    ->RangeMultiplier(8)
+    ->Range(1, 1 << 12)
+    ->Unit(benchmark::kMicrosecond);
+
+/* Latency of small reductions on a shared queue, every call choosing the
+ * work-group size and allocating the buffers of partial results. */
+static void BM_reduce_latency(benchmark::State& state) {
+  const size_t nElems = state.range(0);
+  std::vector<float> hostData(nElems, 1.0f);
+  cl::sycl::queue q;
+  cl::sycl::buffer<float, 1> buf(hostData.data(), cl::sycl::range<1>{nElems});
+  buf.set_final_data(nullptr);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        reduce_grid_stride<float, std::plus<float>>(q, buf));
+  }
+}
+BENCHMARK(BM_reduce_latency)
+    ->RangeMultiplier(8)
+    ->Range(1, 1 << 12)
+    ->Unit(benchmark::kMicrosecond);
+
+/* Latency of small reductions with a reduction object, which builds the
+ * kernel and allocates its buffers once. */
+static void BM_reduction_object_latency(benchmark::State& state) {
+  const size_t nElems = state.range(0);
+  std::vector<float> hostData(nElems, 1.0f);
+  cl::sycl::queue q;
+  cl::sycl::buffer<float, 1> buf(hostData.data(), cl::sycl::range<1>{nElems});
+  buf.set_final_data(nullptr);
+  reduction<float, std::plus<float>> sum(q);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sum(buf));
+  }
+}
+BENCHMARK(BM_reduction_object_latency)
+    ->RangeMultiplier(8)
+    ->Range(1, 1 << 12)
+    ->Unit(benchmark::kMicrosecond);
+
+/* Throughput of computing the sum, minimum, maximum, count and sum of
+ * squares of the number of elements given by the range with one reduction
+ * pass per statistic. */
+static void BM_reduce_statistics_separate(benchmark::State& state) {
+  const size_t nElems = state.range(0);
+  std::vector<float> hostData(nElems, 1.0f);
+  cl::sycl::queue q;
+  cl::sycl::buffer<float, 1> buf(hostData.data(), cl::sycl::range<1>{nElems});
+  buf.set_final_data(nullptr);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        reduce_fused<float, sum_statistic<double>>(q, buf));
+    benchmark::DoNotOptimize(
+        reduce_fused<float, min_statistic<float>>(q, buf));
+    benchmark::DoNotOptimize(
+        reduce_fused<float, max_statistic<float>>(q, buf));
+    benchmark::DoNotOptimize(
+        reduce_fused<float, count_statistic<size_t>>(q, buf));
+    benchmark::DoNotOptimize(
+        reduce_fused<float, sum_of_squares_statistic<double>>(q, buf));
+  }
+  state.SetItemsProcessed(state.iterations() * nElems);
+}
+BENCHMARK(BM_reduce_statistics_separate)
+    ->RangeMultiplier(16)
+    ->Range(1 << 10, 1 << 26)
+    ->Unit(benchmark::kMicrosecond);
+
+/* Throughput of computing the same statistics with a single fused
+ * reduction, reading the input once. */
+static void BM_reduce_statistics_fused(benchmark::State& state) {
+  const size_t nElems = state.range(0);
+  std::vector<float> hostData(nElems, 1.0f);
+  cl::sycl::queue q;
+  cl::sycl::buffer<float, 1> buf(hostData.data(), cl::sycl::range<1>{nElems});
+  buf.set_final_data(nullptr);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        reduce_fused<float, sum_statistic<double>, min_statistic<float>,
+                     max_statistic<float>, count_statistic<size_t>,
+                     sum_of_squares_statistic<double>>(q, buf));
+  }
+  state.SetItemsProcessed(state.iterations() * nElems);
+}
+BENCHMARK(BM_reduce_statistics_fused)
+    ->RangeMultiplier(16)
+    ->Range(1 << 10, 1 << 26)
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
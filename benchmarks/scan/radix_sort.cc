@@ -0,0 +1,168 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  radix_sort.cc
+ *
+ *  Description:
+ *   Keys sorted per second by the radix sort of the scan sample, compared
+ *   with the standard library sorts on the host
+ *
+ **************************************************************************/
+
+#include "benchmark/benchmark.h"
+
+#include <CL/sycl.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "radix_sort.hpp"
+
+template <typename Key>
+std::vector<Key> random_keys(size_t nElems) {
+  std::mt19937_64 gen(42);
+  std::vector<Key> keys(nElems);
+  for (auto& k : keys) {
+    k = static_cast<Key>(gen());
+  }
+  return keys;
+}
+
+/* Keys per second of the radix sort with the given number of bits per pass,
+ * for the number of keys given by the range. Every iteration sorts a new
+ * buffer holding a copy of the same random keys. */
+template <typename Key, unsigned Bits>
+static void BM_par_radix_sort(benchmark::State& state) {
+  const size_t nElems = state.range(0);
+  const std::vector<Key> keys = random_keys<Key>(nElems);
+  cl::sycl::queue q;
+  for (auto _ : state) {
+    state.PauseTiming();
+    cl::sycl::buffer<Key, 1> buf(keys.data(), cl::sycl::range<1>{nElems});
+    state.ResumeTiming();
+    par_radix_sort<Key, Bits>(buf, q);
+    q.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * nElems);
+}
+BENCHMARK_TEMPLATE(BM_par_radix_sort, uint32_t, 4)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_par_radix_sort, uint32_t, 8)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_par_radix_sort, uint64_t, 4)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_par_radix_sort, uint64_t, 8)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMillisecond);
+
+/* Keys per second of the radix sort of 32-bit keys, each with a 32-bit
+ * value, with the given number of bits per pass. */
+template <unsigned Bits>
+static void BM_par_radix_sort_pairs(benchmark::State& state) {
+  const size_t nElems = state.range(0);
+  const std::vector<uint32_t> keys = random_keys<uint32_t>(nElems);
+  std::vector<uint32_t> values(nElems);
+  for (size_t i = 0; i < nElems; i++) {
+    values[i] = static_cast<uint32_t>(i);
+  }
+  const std::vector<uint32_t>& constValues = values;
+  cl::sycl::queue q;
+  for (auto _ : state) {
+    state.PauseTiming();
+    cl::sycl::buffer<uint32_t, 1> keysBuf(keys.data(),
+                                          cl::sycl::range<1>{nElems});
+    cl::sycl::buffer<uint32_t, 1> valuesBuf(constValues.data(),
+                                            cl::sycl::range<1>{nElems});
+    state.ResumeTiming();
+    par_radix_sort<uint32_t, uint32_t, Bits>(keysBuf, valuesBuf, q);
+    q.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * nElems);
+}
+BENCHMARK_TEMPLATE(BM_par_radix_sort_pairs, 4)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_par_radix_sort_pairs, 8)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMillisecond);
+
+/* Keys per second of std::sort on the host, as a baseline. */
+template <typename Key>
+static void BM_std_sort(benchmark::State& state) {
+  const size_t nElems = state.range(0);
+  const std::vector<Key> keys = random_keys<Key>(nElems);
+  std::vector<Key> sorted(nElems);
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::copy(keys.begin(), keys.end(), sorted.begin());
+    state.ResumeTiming();
+    std::sort(sorted.begin(), sorted.end());
+    benchmark::DoNotOptimize(sorted.data());
+  }
+  state.SetItemsProcessed(state.iterations() * nElems);
+}
+BENCHMARK_TEMPLATE(BM_std_sort, uint32_t)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_std_sort, uint64_t)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMillisecond);
+
+/* Keys per second of std::stable_sort of key-value pairs on the host, the
+ * baseline of the radix sort of pairs. */
+static void BM_std_stable_sort_pairs(benchmark::State& state) {
+  const size_t nElems = state.range(0);
+  const std::vector<uint32_t> keys = random_keys<uint32_t>(nElems);
+  std::vector<std::pair<uint32_t, uint32_t>> pairs(nElems);
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (size_t i = 0; i < nElems; i++) {
+      pairs[i] = std::make_pair(keys[i], static_cast<uint32_t>(i));
+    }
+    state.ResumeTiming();
+    std::stable_sort(pairs.begin(), pairs.end(),
+                     [](const std::pair<uint32_t, uint32_t>& a,
+                        const std::pair<uint32_t, uint32_t>& b) {
+                       return a.first < b.first;
+                     });
+    benchmark::DoNotOptimize(pairs.data());
+  }
+  state.SetItemsProcessed(state.iterations() * nElems);
+}
+BENCHMARK(BM_std_stable_sort_pairs)
+    ->RangeMultiplier(16)
+    ->Range(1 << 12, 1 << 24)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
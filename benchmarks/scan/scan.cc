@@ -0,0 +1,195 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  scan.cc
+ *
+ *  Description:
+ *   Throughput of the scan algorithms of the scan sample
+ *
+ **************************************************************************/
+
+#include "benchmark/benchmark.h"
+
+#include <CL/sycl.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "scan.hpp"
+
+using sycl_acc_mode = cl::sycl::access::mode;
+const auto sycl_acc_host = cl::sycl::access::target::host_buffer;
+
+using scan_t = void (*)(cl::sycl::buffer<uint32_t, 1>&, cl::sycl::queue&);
+
+/* Throughput of the given scan algorithm for a sum of the number of elements
+ * given by the range. The buffer is scanned again at every iteration; the
+ * unsigned sums wrap around, which does not affect the time taken. */
+void scan_buffer(benchmark::State& state, scan_t scan) {
+  const size_t nElems = state.range(0);
+  std::vector<uint32_t> hostData(nElems, 1);
+  cl::sycl::queue q;
+  cl::sycl::buffer<uint32_t, 1> buf(hostData.data(),
+                                    cl::sycl::range<1>{nElems});
+  buf.set_final_data(nullptr);
+  for (auto _ : state) {
+    scan(buf, q);
+    q.wait();
+  }
+  auto hostAcc = buf.get_access<sycl_acc_mode::read, sycl_acc_host>();
+  benchmark::DoNotOptimize(hostAcc[nElems - 1]);
+  state.SetItemsProcessed(state.iterations() * nElems);
+  state.SetBytesProcessed(state.iterations() * 2 * nElems * sizeof(uint32_t));
+}
+
+/* Recursive scan, with three kernel launches per level, and the given local
+ * memory layout for the work-group scan. */
+template <typename Layout>
+static void BM_par_scan(benchmark::State& state) {
+  scan_buffer(state, par_scan<uint32_t, std::plus<uint32_t>, Layout>);
+}
+BENCHMARK_TEMPLATE(BM_par_scan, unpadded_layout)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24)
+    ->Arg(1000003)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_par_scan, padded_layout<>)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24)
+    ->Arg(1000003)
+    ->Unit(benchmark::kMicrosecond);
+
+/* Out-of-place recursive scan reusing the same workspace, which allocates
+ * nothing in the loop and has two kernel launches per level. */
+static void BM_par_scan_workspace(benchmark::State& state) {
+  const size_t nElems = state.range(0);
+  std::vector<uint32_t> hostData(nElems, 1);
+  cl::sycl::queue q;
+  cl::sycl::buffer<uint32_t, 1> in(hostData.data(),
+                                   cl::sycl::range<1>{nElems});
+  cl::sycl::buffer<uint32_t, 1> out{cl::sycl::range<1>{nElems}};
+  in.set_final_data(nullptr);
+  scan_workspace<uint32_t> ws(q, nElems);
+  for (auto _ : state) {
+    par_scan<uint32_t, std::plus<uint32_t>>(in, out, ws, q);
+    q.wait();
+  }
+  auto hostAcc = out.get_access<sycl_acc_mode::read, sycl_acc_host>();
+  benchmark::DoNotOptimize(hostAcc[nElems - 1]);
+  state.SetItemsProcessed(state.iterations() * nElems);
+  state.SetBytesProcessed(state.iterations() * 2 * nElems * sizeof(uint32_t));
+}
+BENCHMARK(BM_par_scan_workspace)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24)
+    ->Arg(1000003)
+    ->Unit(benchmark::kMicrosecond);
+
+/* Single-pass scan with decoupled look-back. */
+static void BM_par_scan_single_pass(benchmark::State& state) {
+  scan_buffer(state, par_scan_single_pass<uint32_t, std::plus<uint32_t>>);
+}
+BENCHMARK(BM_par_scan_single_pass)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24)
+    ->Arg(1000003)
+    ->Unit(benchmark::kMicrosecond);
+
+/* Register-blocked scan with K elements per work-item. */
+template <size_t K>
+static void BM_par_scan_blocked(benchmark::State& state) {
+  scan_buffer(state, par_scan_blocked<uint32_t, std::plus<uint32_t>, K>);
+}
+BENCHMARK_TEMPLATE(BM_par_scan_blocked, 2)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_par_scan_blocked, 4)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_par_scan_blocked, 8)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_par_scan_blocked, 16)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24)
+    ->Unit(benchmark::kMicrosecond);
+
+/* Register-blocked scan with the block size chosen for the device. */
+static void BM_par_scan_blocked_auto(benchmark::State& state) {
+  scan_buffer(state, par_scan_blocked<uint32_t, std::plus<uint32_t>>);
+}
+BENCHMARK(BM_par_scan_blocked_auto)
+    ->RangeMultiplier(16)
+    ->Range(1 << 8, 1 << 24)
+    ->Arg(1000003)
+    ->Unit(benchmark::kMicrosecond);
+
+/* Throughput of the scan of every row of a matrix, calling `par_scan` on a
+ * buffer per row. The range is the length of the rows and their number. */
+static void BM_par_scan_loop_rows(benchmark::State& state) {
+  const size_t cols = state.range(0);
+  const size_t rows = state.range(1);
+  std::vector<uint32_t> hostData(cols, 1);
+  cl::sycl::queue q;
+  std::vector<cl::sycl::buffer<uint32_t, 1>> bufs;
+  for (size_t r = 0; r < rows; r++) {
+    bufs.emplace_back(hostData.data(), cl::sycl::range<1>{cols});
+    bufs.back().set_final_data(nullptr);
+  }
+  for (auto _ : state) {
+    for (auto& buf : bufs) {
+      par_scan<uint32_t, std::plus<uint32_t>>(buf, q);
+    }
+    q.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * rows * cols);
+}
+BENCHMARK(BM_par_scan_loop_rows)
+    ->Args({300, 1000})
+    ->Args({300, 4000})
+    ->Args({3000, 400})
+    ->Unit(benchmark::kMillisecond);
+
+/* Throughput of the scan of every row of a matrix in a single launch. */
+static void BM_par_scan_rows(benchmark::State& state) {
+  const size_t cols = state.range(0);
+  const size_t rows = state.range(1);
+  std::vector<uint32_t> hostData(rows * cols, 1);
+  cl::sycl::queue q;
+  cl::sycl::buffer<uint32_t, 2> matrix(hostData.data(),
+                                       cl::sycl::range<2>{rows, cols});
+  matrix.set_final_data(nullptr);
+  for (auto _ : state) {
+    par_scan_rows<uint32_t, std::plus<uint32_t>>(matrix, q);
+    q.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * rows * cols);
+}
+BENCHMARK(BM_par_scan_rows)
+    ->Args({300, 1000})
+    ->Args({300, 4000})
+    ->Args({3000, 400})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,97 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  allocators.cc
+ *
+ *  Description:
+ *   Microbenchmarks of the construction of SYCL buffers with the
+ *   allocators of the smart-pointer sample, including the allocation of
+ *   their host storage
+ *
+ **************************************************************************/
+
+#include "benchmark/benchmark.h"
+
+#include <CL/sycl.hpp>
+
+#include <memory>
+
+#include "concurrent_stack_allocator.hpp"
+
+const auto sycl_acc_write = cl::sycl::access::mode::discard_write;
+const auto sycl_acc_host = cl::sycl::access::target::host_buffer;
+
+/* Every thread constructs this number of buffers, so that the
+ * concurrent stack never runs out of storage. */
+const size_t numIterations = 10000;
+const int maxThreads = 16;
+const size_t maxElems = 256;
+
+using bench_stack_t = concurrent_stack<64>;
+
+/* Stack shared by all the threads of BM_buffer_concurrent_stack. */
+bench_stack_t& get_stack() {
+  static bench_stack_t theStack(maxThreads * numIterations * maxElems *
+                          sizeof(float));
+  return theStack;
+}
+
+/* Throughput of the construction and destruction of buffers using the
+ * given allocator, from several threads at the same time. A buffer need
+ * not allocate its host storage until it is accessed on the host, so a
+ * host accessor is requested to make the allocator part of the loop. */
+template <typename Allocator>
+void construct_buffers(benchmark::State& state, const Allocator& alloc) {
+  const size_t nElems = state.range(0);
+  for (auto _ : state) {
+    cl::sycl::buffer<float, 1, Allocator> buf(cl::sycl::range<1>{nElems},
+                                              alloc);
+    auto hostAcc = buf.template get_access<sycl_acc_write, sycl_acc_host>();
+    benchmark::DoNotOptimize(hostAcc[0]);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * nElems * sizeof(float));
+}
+
+static void BM_buffer_std_allocator(benchmark::State& state) {
+  construct_buffers(state, std::allocator<float>());
+}
+BENCHMARK(BM_buffer_std_allocator)
+    ->Arg(16)
+    ->Arg(maxElems)
+    ->ThreadRange(1, maxThreads)
+    ->Iterations(numIterations)
+    ->UseRealTime();
+
+static void BM_buffer_concurrent_stack(benchmark::State& state) {
+  // The other threads wait for this one at the start of the loop
+  if (state.thread_index == 0) {
+    get_stack().reset();
+  }
+  construct_buffers(state, concurrent_stack_allocator<float, 64>(get_stack()));
+}
+BENCHMARK(BM_buffer_concurrent_stack)
+    ->Arg(16)
+    ->Arg(maxElems)
+    ->ThreadRange(1, maxThreads)
+    ->Iterations(numIterations)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,107 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  huge_pages.cc
+ *
+ *  Description:
+ *   Bandwidth of large SYCL buffers on the host device, with their
+ *   storage allocated from regular or from huge pages
+ *
+ **************************************************************************/
+
+#include "benchmark/benchmark.h"
+
+#include <CL/sycl.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "huge_page_allocator.hpp"
+
+using sycl_acc_mode = cl::sycl::access::mode;
+const sycl_acc_mode sycl_acc_read = sycl_acc_mode::read;
+const sycl_acc_mode sycl_acc_write = sycl_acc_mode::discard_write;
+const auto sycl_acc_host = cl::sycl::access::target::host_buffer;
+
+template <typename Allocator>
+class transpose_kernel;
+
+/* Bandwidth of the construction of a matrix buffer from host data,
+ * i.e, of the copy of the data into the storage of the buffer. The range
+ * is the number of rows of the square matrix. */
+template <typename Allocator>
+static void BM_copy_to_buffer(benchmark::State& state) {
+  const size_t n = state.range(0);
+  std::vector<float> hostData(n * n, 1.0f);
+  for (auto _ : state) {
+    cl::sycl::buffer<float, 1, Allocator> buf(
+        hostData.data(), cl::sycl::range<1>{n * n}, Allocator());
+    auto hostAcc = buf.template get_access<sycl_acc_read, sycl_acc_host>();
+    benchmark::DoNotOptimize(hostAcc[n * n - 1]);
+  }
+  state.SetBytesProcessed(state.iterations() * n * n * sizeof(float));
+}
+BENCHMARK_TEMPLATE(BM_copy_to_buffer, std::allocator<float>)
+    ->Arg(2048)
+    ->Arg(4096)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_copy_to_buffer, huge_page_allocator<float>)
+    ->Arg(2048)
+    ->Arg(4096)
+    ->Unit(benchmark::kMillisecond);
+
+/* Bandwidth of a kernel that transposes a matrix. Reading the columns
+ * touches a different page every few elements, so it is dominated by TLB
+ * misses when the matrix is stored in regular pages. The range is the
+ * number of rows of the square matrix. */
+template <typename Allocator>
+static void BM_transpose_kernel(benchmark::State& state) {
+  const size_t n = state.range(0);
+  std::vector<float> hostData(n * n, 1.0f);
+  cl::sycl::queue q;
+  cl::sycl::buffer<float, 1, Allocator> in(
+      hostData.data(), cl::sycl::range<1>{n * n}, Allocator());
+  cl::sycl::buffer<float, 1, Allocator> out(cl::sycl::range<1>{n * n},
+                                            Allocator());
+  for (auto _ : state) {
+    q.submit([&](cl::sycl::handler& h) {
+      auto inAcc = in.template get_access<sycl_acc_read>(h);
+      auto outAcc = out.template get_access<sycl_acc_write>(h);
+      h.parallel_for<transpose_kernel<Allocator>>(
+          cl::sycl::range<2>{n, n}, [=](cl::sycl::item<2> it) {
+            size_t i = it.get_id()[0];
+            size_t j = it.get_id()[1];
+            outAcc[i * n + j] = inAcc[j * n + i];
+          });
+    });
+    q.wait();
+  }
+  state.SetBytesProcessed(state.iterations() * 2 * n * n * sizeof(float));
+}
+BENCHMARK_TEMPLATE(BM_transpose_kernel, std::allocator<float>)
+    ->Arg(2048)
+    ->Arg(4096)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_transpose_kernel, huge_page_allocator<float>)
+    ->Arg(2048)
+    ->Arg(4096)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
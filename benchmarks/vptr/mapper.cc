@@ -0,0 +1,148 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  mapper.cc
+ *
+ *  Description:
+ *   Microbenchmarks of the virtual pointer PointerMapper
+ *
+ **************************************************************************/
+
+#include "benchmark/benchmark.h"
+
+#include <CL/sycl.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "vptr/virtual_ptr.hpp"
+
+using sycl_acc_mode = cl::sycl::access::mode;
+const sycl_acc_mode sycl_acc_rw = sycl_acc_mode::read_write;
+
+using namespace cl::sycl::codeplay;
+
+/* Size in bytes of every allocation of the live set. */
+const size_t allocSize = 256;
+
+/* Populates the given mapper with numPtrs live allocations and returns
+ * a randomly shuffled list of pointers into them, so lookups do not
+ * always hit the same node of the map. */
+std::vector<void *> make_live_set(PointerMapper &pMap, size_t numPtrs) {
+  std::vector<void *> ptrs(numPtrs);
+  for (auto &ptr : ptrs) {
+    ptr = static_cast<uint8_t *>(SYCLmalloc(allocSize, pMap)) + allocSize / 2;
+  }
+  std::shuffle(ptrs.begin(), ptrs.end(), std::default_random_engine{});
+  return ptrs;
+}
+
+/* Latency of SYCLmalloc with the given number of live allocations. */
+static void BM_vptr_malloc(benchmark::State &state) {
+  PointerMapper pMap;
+  auto live = make_live_set(pMap, state.range(0));
+  for (auto _ : state) {
+    void *ptr = SYCLmalloc(allocSize, pMap);
+    benchmark::DoNotOptimize(ptr);
+    state.PauseTiming();
+    SYCLfree(ptr, pMap);
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_vptr_malloc)->RangeMultiplier(8)->Range(1, 1 << 12);
+
+/* Latency of SYCLfree with the given number of live allocations. */
+static void BM_vptr_free(benchmark::State &state) {
+  PointerMapper pMap;
+  auto live = make_live_set(pMap, state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    void *ptr = SYCLmalloc(allocSize, pMap);
+    state.ResumeTiming();
+    SYCLfree(ptr, pMap);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_vptr_free)->RangeMultiplier(8)->Range(1, 1 << 12);
+
+/* Latency of get_offset on random pointers of the live set. */
+static void BM_vptr_get_offset(benchmark::State &state) {
+  PointerMapper pMap;
+  auto live = make_live_set(pMap, state.range(0));
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(pMap.get_offset(live[i]));
+    i = (i + 1 == live.size()) ? 0 : i + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_vptr_get_offset)->RangeMultiplier(8)->Range(1, 1 << 12);
+
+/* Latency of get_buffer on random pointers of the live set. */
+static void BM_vptr_get_buffer(benchmark::State &state) {
+  PointerMapper pMap;
+  auto live = make_live_set(pMap, state.range(0));
+  size_t i = 0;
+  for (auto _ : state) {
+    auto b = pMap.get_buffer(live[i]);
+    benchmark::DoNotOptimize(b);
+    i = (i + 1 == live.size()) ? 0 : i + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_vptr_get_buffer)->RangeMultiplier(8)->Range(1, 1 << 12);
+
+/* Cost of submitting an empty command group, the baseline for
+ * BM_vptr_get_access. */
+static void BM_vptr_submit(benchmark::State &state) {
+  cl::sycl::queue q;
+  for (auto _ : state) {
+    q.submit([&](cl::sycl::handler &h) {
+      h.single_task<class vptr_submit>([=]() {});
+    });
+  }
+  q.wait();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_vptr_submit);
+
+/* Latency of submitting a command group that obtains a device accessor
+ * from a random pointer of the live set. Subtract BM_vptr_submit to
+ * obtain the cost of get_access itself. */
+static void BM_vptr_get_access(benchmark::State &state) {
+  PointerMapper pMap;
+  auto live = make_live_set(pMap, state.range(0));
+  cl::sycl::queue q;
+  size_t i = 0;
+  for (auto _ : state) {
+    q.submit([&](cl::sycl::handler &h) {
+      auto acc = pMap.get_access<sycl_acc_rw>(live[i], h);
+      h.single_task<class vptr_get_access>([=]() { (void)acc; });
+    });
+    i = (i + 1 == live.size()) ? 0 : i + 1;
+  }
+  q.wait();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_vptr_get_access)->RangeMultiplier(8)->Range(1, 1 << 12);
+
+BENCHMARK_MAIN();
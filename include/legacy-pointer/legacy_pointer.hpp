@@ -31,30 +31,163 @@
  **************************************************************************/
 
 #include <CL/sycl.hpp>
+
+#ifndef CODEPLAY_LEGACY_POINTER
+#define CODEPLAY_LEGACY_POINTER
+
 #include <iostream>
 
-#include <unordered_map>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+#include <atomic>
+#include <mutex>
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
 
 namespace codeplay {
 namespace legacy {
 
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+/**
+ * MapperRegistry
+ *  Records which PointerMapper owns each range of buffer ids, so that
+ *  pointers can be looked up and freed from any thread.
+ *  Ranges are claimed, released and looked up using atomic operations
+ *  only. Adopting, abandoning and destroying mappers, which only happens
+ *  when threads start or exit or when the last buffer of a mapper is freed
+ *  by another thread, is serialized by a mutex, so that a mapper is never
+ *  destroyed while another thread is adopting it.
+ */
+template <typename PointerMapperT>
+class MapperRegistry {
+ public:
+  using buffer_id = typename PointerMapperT::buffer_id;
+
+  static const unsigned long NUMBER_RANGES = PointerMapperT::NUMBER_ID_RANGES;
+
+  MapperRegistry() {
+    for (auto &owner : m_owners) {
+      owner.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  /* claim_range.
+   * Assigns a free range of ids to the given mapper and returns its index,
+   * or NUMBER_RANGES if all the ranges are in use.
+   */
+  unsigned long claim_range(PointerMapperT *mapper) {
+    for (unsigned long r = 0; r < NUMBER_RANGES; r++) {
+      PointerMapperT *expected = nullptr;
+      if (m_owners[r].load(std::memory_order_relaxed) == nullptr &&
+          m_owners[r].compare_exchange_strong(expected, mapper,
+                                              std::memory_order_acq_rel)) {
+        return r;
+      }
+    }
+    return NUMBER_RANGES;
+  }
+
+  /* release_range.
+   * Makes the given range available to other mappers.
+   */
+  void release_range(unsigned long r) {
+    m_owners[r].store(nullptr, std::memory_order_release);
+  }
+
+  /* get_owner.
+   * Returns the mapper that issued the given buffer id, or nullptr if
+   * the id is not in use.
+   */
+  PointerMapperT *get_owner(buffer_id bId) const {
+    return m_owners[bId >> PointerMapperT::ID_RANGE_BITSIZE].load(
+        std::memory_order_acquire);
+  }
+
+  /* adopt.
+   * Returns a mapper abandoned by an exited thread, taking ownership of it,
+   * or nullptr if there is none.
+   */
+  PointerMapperT *adopt() {
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    for (auto &owner : m_owners) {
+      PointerMapperT *mapper = owner.load(std::memory_order_acquire);
+      if (mapper != nullptr && mapper->m_abandoned) {
+        mapper->m_abandoned = false;
+        return mapper;
+      }
+    }
+    return nullptr;
+  }
+
+  /* retire.
+   * Called when the owner thread of the mapper exits. The mapper is
+   * destroyed if it has no live buffers, otherwise it is abandoned: it
+   * stays registered so the buffers remain reachable, and it can be
+   * adopted by a new thread.
+   */
+  void retire(PointerMapperT *mapper) {
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    if (mapper->count() == 0) {
+      delete mapper;
+    } else {
+      mapper->m_abandoned = true;
+    }
+  }
+
+  /* release_abandoned.
+   * Called after another thread freed the last live buffer of the mapper
+   * that issued the given id. Destroys the mapper if its owner thread has
+   * exited. The mapper is looked up again under the lock, since its owner
+   * may have destroyed it in the meantime.
+   */
+  void release_abandoned(buffer_id bId) {
+    std::lock_guard<std::mutex> lock(m_lifecycleMutex);
+    PointerMapperT *mapper = get_owner(bId);
+    if (mapper != nullptr && mapper->m_abandoned && mapper->count() == 0) {
+      delete mapper;
+    }
+  }
+
+ private:
+  /* Owner of each range of ids
+   */
+  std::array<std::atomic<PointerMapperT *>, NUMBER_RANGES> m_owners;
+
+  /* Serializes the adoption and destruction of mappers
+   */
+  std::mutex m_lifecycleMutex;
+};
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
+
 /**
- * PointerMapper
+ * BasicPointerMapper
  *  Associates fake pointers with buffers.
- *
+ *  BufferIdBits is the number of most significant bits of the pointer
+ *  used for the buffer id, the remaining bits hold the offset.
  */
-class PointerMapper {
+template <unsigned BufferIdBits>
+class BasicPointerMapper {
  public:
+  using base_ptr_t = std::uintptr_t;
+
   /* pointer information definitions
    */
-  static const unsigned long ADDRESS_BITS = sizeof(void *) * 8;
-  static const unsigned long BUFFER_ID_BITSIZE = 16u;
-  static const unsigned long MAX_NUMBER_BUFFERS =
-      (1UL << BUFFER_ID_BITSIZE) - 1;
-  static const unsigned long MAX_OFFSET =
-      (1UL << (ADDRESS_BITS - BUFFER_ID_BITSIZE)) - 1;
-
-  using base_ptr_t = uintptr_t;
+  static constexpr base_ptr_t ADDRESS_BITS = sizeof(void *) * 8;
+  static constexpr base_ptr_t BUFFER_ID_BITSIZE = BufferIdBits;
+  static constexpr base_ptr_t OFFSET_BITSIZE = ADDRESS_BITS - BUFFER_ID_BITSIZE;
+  static constexpr base_ptr_t MAX_NUMBER_BUFFERS =
+      (base_ptr_t(1) << BUFFER_ID_BITSIZE) - 1;
+  static constexpr base_ptr_t MAX_OFFSET =
+      (base_ptr_t(1) << OFFSET_BITSIZE) - 1;
+
+  static_assert(BufferIdBits > 0 && BufferIdBits < ADDRESS_BITS,
+                "The buffer id and the offset need at least one bit each");
+  static_assert(BufferIdBits <= 32,
+                "The buffer table supports buffer ids of up to 32 bits");
 
   /* Fake Pointers are constructed using an integer indexing plus
    * the offset:
@@ -77,7 +210,7 @@ class PointerMapper {
     /**
      * Convert back to the integer number.
      */
-    operator base_ptr_t() const { return m_contents; }
+    constexpr operator base_ptr_t() const { return m_contents; }
 
     /**
      * Converts a void * into a legacy pointer structure.
@@ -92,7 +225,7 @@ class PointerMapper {
      * Creates a legacy_pointer_t from the given integer
      * number
      */
-    legacy_pointer_t(base_ptr_t u) : m_contents(u){};
+    constexpr legacy_pointer_t(base_ptr_t u) : m_contents(u){};
   };
 
   /* Whether if a pointer is null or not.
@@ -116,46 +249,118 @@ class PointerMapper {
    */
   using buffer_t = cl::sycl::buffer<buffer_data_type, 1>;
 
-  /* id of a buffer in the map
+  /* id of a buffer in the map, the smallest unsigned type that holds
+   * BUFFER_ID_BITSIZE bits
    */
-  using buffer_id = short;
+  using buffer_id = typename std::conditional<(BufferIdBits <= 16),
+                                              std::uint16_t,
+                                              std::uint32_t>::type;
 
   /* get_buffer_id
    */
-  inline buffer_id get_buffer_id(legacy_pointer_t ptr) const {
-    return ptr >> (ADDRESS_BITS - BUFFER_ID_BITSIZE);
+  static constexpr buffer_id get_buffer_id(legacy_pointer_t ptr) {
+    return static_cast<buffer_id>(base_ptr_t(ptr) >> OFFSET_BITSIZE);
   }
 
   /*
    * get_buffer_offset
    */
-  inline off_t get_offset(legacy_pointer_t ptr) const {
-    return ptr & MAX_OFFSET;
-    ;
+  static constexpr off_t get_offset(legacy_pointer_t ptr) {
+    return static_cast<off_t>(base_ptr_t(ptr) & MAX_OFFSET);
+  }
+
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+  /* Ids are handed out to each mapper in ranges of ID_RANGE_SIZE
+   * consecutive ids, which match the chunks of the buffer table.
+   */
+  static constexpr base_ptr_t ID_RANGE_BITSIZE = (BufferIdBits + 1) / 2;
+  static constexpr base_ptr_t ID_RANGE_SIZE = base_ptr_t(1)
+                                              << ID_RANGE_BITSIZE;
+  static constexpr base_ptr_t NUMBER_ID_RANGES =
+      (MAX_NUMBER_BUFFERS >> ID_RANGE_BITSIZE) + 1;
+
+  using registry_t = MapperRegistry<BasicPointerMapper>;
+
+  /**
+   * Registry shared by all the mappers of the program.
+   */
+  static registry_t &get_registry() {
+    static registry_t theRegistry;
+    return theRegistry;
   }
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
 
   /**
    * Constructs the PointerMapper structure.
    */
-  PointerMapper()
-      : m_pointerMap{}{};
+  BasicPointerMapper()
+      : m_chunks{},
+        m_count{0},
+        m_lastId{0},
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+        m_idRangeEnd{0},
+        m_remoteFreeIds{0},
+        m_abandoned{false},
+#else
+        m_idRangeEnd{MAX_NUMBER_BUFFERS + 1},
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
+        m_freeIds{}{};
 
   /**
    * PointerMapper cannot be copied or moved
    */
-  PointerMapper(const PointerMapper &) = delete;
+  BasicPointerMapper(const BasicPointerMapper &) = delete;
+
+  /**
+   * Destroys all the buffers still alive in the mapper.
+   */
+  ~BasicPointerMapper() { clear(); }
 
   /**
   *	empty the pointer list
   */
-  inline void clear() { m_pointerMap.clear(); }
+  inline void clear() {
+    for (base_ptr_t c = 0; m_chunks && c < NUMBER_CHUNKS; c++) {
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+      // Only the chunks of the ranges owned by this mapper are allocated
+      if (m_chunks[c]) {
+        m_chunks[c].reset();
+        get_registry().release_range(c);
+      }
+#else
+      m_chunks[c].reset();
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
+    }
+    m_count = 0;
+    m_lastId = 0;
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+    m_idRangeEnd = 0;
+    m_remoteFreeIds.store(0, std::memory_order_relaxed);
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
+    m_freeIds.clear();
+  }
 
   /* generate_id
    * Generates a unique id for a buffer.
+   * Ids released by remove_pointer are reused first, most recently
+   * released first, so the same few slots of the table stay in cache.
+   * Returns 0 (i.e, the id of the null pointer) if all ids are in use.
    */
   buffer_id generate_id() {
-    static buffer_id counter = 0;
-    return ++counter;
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+    if (m_freeIds.empty()) {
+      reclaim_remote_ids();
+    }
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
+    if (!m_freeIds.empty()) {
+      buffer_id bId = m_freeIds.back();
+      m_freeIds.pop_back();
+      return bId;
+    }
+    if (m_lastId + base_ptr_t(1) >= m_idRangeEnd && !claim_id_range()) {
+      return 0;
+    }
+    return ++m_lastId;
   }
 
   /* add_pointer.
@@ -163,12 +368,14 @@ class PointerMapper {
    * This will be the bufferId on the most significant bytes and 0 elsewhere.
    */
   legacy_pointer_t add_pointer(buffer_t &&b) {
-    auto nextNumber = m_pointerMap.size();
     buffer_id bId = generate_id();
-    m_pointerMap.emplace(bId, b);
-    if (nextNumber > MAX_NUMBER_BUFFERS) {
+    if (bId == 0) {
       return null_legacy_ptr;
     }
+    buffer_slot_t &slot = get_slot(bId);
+    new (&slot.m_storage) buffer_t(std::move(b));
+    slot.m_used = true;
+    ++m_count;
     base_ptr_t retVal = bId;
     retVal <<= (ADDRESS_BITS - BUFFER_ID_BITSIZE);
     return retVal;
@@ -178,9 +385,16 @@ class PointerMapper {
    * Returns a buffer from the map using the buffer id
    */
   buffer_t get_buffer(buffer_id bId) const {
-    auto it = m_pointerMap.find(bId);
-    if (it != m_pointerMap.end()) {
-      return it->second;
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+    // The buffer may have been allocated by another thread
+    const BasicPointerMapper *owner = get_registry().get_owner(bId);
+#else
+    const BasicPointerMapper *owner = this;
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
+    const buffer_slot_t *slot =
+        (owner != nullptr) ? owner->find_slot(bId) : nullptr;
+    if (slot != nullptr && slot->m_used) {
+      return slot->get();
     }
 
     std::cerr << "No sycl buffer has been found. Make sure that you have "
@@ -189,46 +403,341 @@ class PointerMapper {
     std::abort();
   }
 
+  /* get_access.
+   * Returns an accessor to the count bytes of the buffer of the given
+   * pointer that start at the offset encoded in it, so only that slice of
+   * the buffer is requested by the command group.
+   * As for any ranged accessor, the accessor is indexed with positions in
+   * the whole buffer, i.e, the first byte of the slice is at
+   * get_offset(ptr).
+   */
+  template <cl::sycl::access::mode access_mode,
+            cl::sycl::access::target access_target =
+                cl::sycl::access::target::global_buffer>
+  cl::sycl::accessor<buffer_data_type, 1, access_mode, access_target>
+  get_access(void *ptr, size_t count, cl::sycl::handler &cgh) const {
+    buffer_t b = get_buffer(get_buffer_id(ptr));
+    return b.template get_access<access_mode, access_target>(
+        cgh, cl::sycl::range<1>{count},
+        cl::sycl::id<1>{static_cast<size_t>(get_offset(ptr))});
+  }
+
   /* remove_pointer.
    * Removes the given pointer from the map.
    */
   void remove_pointer(void *ptr) {
     buffer_id bId = this->get_buffer_id(ptr);
-    m_pointerMap.erase(bId);
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+    // Buffers allocated by another thread are returned to their owner
+    BasicPointerMapper *owner = get_registry().get_owner(bId);
+    if (owner != this) {
+      if (owner != nullptr && owner->remove_remote(bId)) {
+        get_registry().release_abandoned(bId);
+      }
+      return;
+    }
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
+    buffer_slot_t *slot = find_slot(bId);
+    if (slot != nullptr && slot->m_used) {
+      slot->destroy();
+      --m_count;
+      m_freeIds.push_back(bId);
+    }
   }
 
   /* count.
    * Return the number of active pointers (i.e, pointers that
    * have been malloc but not freed).
    */
-  size_t count() const { return m_pointerMap.size(); }
+  size_t count() const { return m_count; }
+
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+  /* remove_remote.
+   * Destroys the buffer of an id owned by this mapper on behalf of
+   * another thread. The id is handed back through a lock-free stack,
+   * and reused once the owner runs out of free ids.
+   * Returns true if it was the last live buffer of the mapper.
+   */
+  bool remove_remote(buffer_id bId) {
+    buffer_slot_t *slot = find_slot(bId);
+    if (slot == nullptr || !slot->m_used) {
+      return false;
+    }
+    slot->destroy();
+    buffer_id head = m_remoteFreeIds.load(std::memory_order_relaxed);
+    do {
+      slot->m_nextFree = head;
+    } while (!m_remoteFreeIds.compare_exchange_weak(
+        head, bId, std::memory_order_release, std::memory_order_relaxed));
+    // This must be the last access to the mapper, since its owner may
+    // destroy it as soon as the count reaches zero
+    return m_count.fetch_sub(1) == 1;
+  }
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
 
  private:
-  /* Maps the buffer id numbers to the actual buffer
-   * instances.
-    */
-  std::unordered_map<buffer_id, buffer_t> m_pointerMap;
+  /* The buffers are stored in a table directly indexed by the buffer id.
+   * The table is split in chunks of CHUNK_SIZE slots that are only
+   * allocated the first time one of their ids is used. Half of the bits
+   * of the id select the chunk, so both levels of the table stay small.
+   */
+  static constexpr base_ptr_t CHUNK_BITSIZE = (BufferIdBits + 1) / 2;
+  static constexpr base_ptr_t CHUNK_SIZE = base_ptr_t(1) << CHUNK_BITSIZE;
+  static constexpr base_ptr_t NUMBER_CHUNKS =
+      (MAX_NUMBER_BUFFERS >> CHUNK_BITSIZE) + 1;
+
+  /* Entry of the buffer table.
+   * The buffer is constructed in place when the id is in use.
+   */
+  struct buffer_slot_t {
+    bool m_used;
+    /* Next id in the stack of ids removed by other threads */
+    buffer_id m_nextFree;
+    typename std::aligned_storage<sizeof(buffer_t), alignof(buffer_t)>::type
+        m_storage;
+
+    buffer_slot_t() : m_used{false} {}
+
+    buffer_t &get() { return *reinterpret_cast<buffer_t *>(&m_storage); }
+
+    const buffer_t &get() const {
+      return *reinterpret_cast<const buffer_t *>(&m_storage);
+    }
+
+    void destroy() {
+      get().~buffer_t();
+      m_used = false;
+    }
+
+    ~buffer_slot_t() {
+      if (m_used) {
+        destroy();
+      }
+    }
+  };
+
+  using buffer_chunk_t = std::array<buffer_slot_t, CHUNK_SIZE>;
+
+  /* find_slot.
+   * Returns the slot of the given id, or nullptr if its chunk
+   * has not been allocated.
+   */
+  buffer_slot_t *find_slot(buffer_id bId) const {
+    if (!m_chunks) {
+      return nullptr;
+    }
+    auto &chunk = m_chunks[bId >> CHUNK_BITSIZE];
+    if (!chunk) {
+      return nullptr;
+    }
+    return &(*chunk)[bId & (CHUNK_SIZE - 1)];
+  }
+
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+  /* claim_id_range.
+   * Obtains a new range of ids from the registry.
+   * Returns false if all of them are in use.
+   */
+  bool claim_id_range() {
+    auto r = get_registry().claim_range(this);
+    if (r == NUMBER_ID_RANGES) {
+      return false;
+    }
+    // Allocate the chunk before any id of the range is issued, so that
+    // other threads never modify the table of this mapper.
+    get_chunk(r).reset(new buffer_chunk_t{});
+    m_lastId = (r == 0) ? 0 : r * ID_RANGE_SIZE - 1;
+    m_idRangeEnd = (r + 1) * ID_RANGE_SIZE;
+    return true;
+  }
+
+  /* reclaim_remote_ids.
+   * Moves the ids removed by other threads to the list of free ids.
+   */
+  void reclaim_remote_ids() {
+    buffer_id bId = m_remoteFreeIds.exchange(0, std::memory_order_acquire);
+    while (bId != 0) {
+      m_freeIds.push_back(bId);
+      bId = find_slot(bId)->m_nextFree;
+    }
+  }
+#else
+  /* claim_id_range.
+   * A single mapper owns the whole range of ids.
+   */
+  bool claim_id_range() { return false; }
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
+
+  /* get_slot.
+   * Returns the slot of the given id, allocating its chunk if needed.
+   */
+  buffer_slot_t &get_slot(buffer_id bId) {
+    auto &chunk = get_chunk(bId >> CHUNK_BITSIZE);
+    if (!chunk) {
+      chunk.reset(new buffer_chunk_t{});
+    }
+    return (*chunk)[bId & (CHUNK_SIZE - 1)];
+  }
+
+  /* get_chunk.
+   * Returns the entry of the given chunk in the chunk directory,
+   * allocating the directory on first use.
+   */
+  std::unique_ptr<buffer_chunk_t> &get_chunk(base_ptr_t c) {
+    if (!m_chunks) {
+      m_chunks.reset(new std::unique_ptr<buffer_chunk_t>[NUMBER_CHUNKS]());
+    }
+    return m_chunks[c];
+  }
+
+  /* Table of buffers indexed by buffer id.
+   * The directory of NUMBER_CHUNKS chunk pointers is itself allocated
+   * lazily, since it takes 512KB with 32-bit ids, which would otherwise be
+   * paid by every mapper, i.e, by every thread in thread-local mode.
+   */
+  std::unique_ptr<std::unique_ptr<buffer_chunk_t>[]> m_chunks;
+
+  /* Number of buffers currently in the table.
+   */
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+  std::atomic<size_t> m_count;
+#else
+  size_t m_count;
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
+
+  /* Highest buffer id issued so far.
+   */
+  buffer_id m_lastId;
+
+  /* End (exclusive) of the range of ids currently used by the mapper.
+   */
+  base_ptr_t m_idRangeEnd;
+
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+  /* Top of the stack of ids removed by other threads.
+   */
+  std::atomic<buffer_id> m_remoteFreeIds;
+
+  /* Whether the owner thread of the mapper has exited.
+   * Guarded by the lifecycle mutex of the registry.
+   */
+  bool m_abandoned;
+
+  friend registry_t;
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
+
+  /* Ids of removed buffers, available for reuse.
+   */
+  std::vector<buffer_id> m_freeIds;
+};
+
+template <unsigned BufferIdBits>
+constexpr typename BasicPointerMapper<BufferIdBits>::base_ptr_t
+    BasicPointerMapper<BufferIdBits>::ADDRESS_BITS;
+template <unsigned BufferIdBits>
+constexpr typename BasicPointerMapper<BufferIdBits>::base_ptr_t
+    BasicPointerMapper<BufferIdBits>::BUFFER_ID_BITSIZE;
+template <unsigned BufferIdBits>
+constexpr typename BasicPointerMapper<BufferIdBits>::base_ptr_t
+    BasicPointerMapper<BufferIdBits>::OFFSET_BITSIZE;
+template <unsigned BufferIdBits>
+constexpr typename BasicPointerMapper<BufferIdBits>::base_ptr_t
+    BasicPointerMapper<BufferIdBits>::MAX_NUMBER_BUFFERS;
+template <unsigned BufferIdBits>
+constexpr typename BasicPointerMapper<BufferIdBits>::base_ptr_t
+    BasicPointerMapper<BufferIdBits>::MAX_OFFSET;
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+template <unsigned BufferIdBits>
+constexpr typename BasicPointerMapper<BufferIdBits>::base_ptr_t
+    BasicPointerMapper<BufferIdBits>::ID_RANGE_BITSIZE;
+template <unsigned BufferIdBits>
+constexpr typename BasicPointerMapper<BufferIdBits>::base_ptr_t
+    BasicPointerMapper<BufferIdBits>::ID_RANGE_SIZE;
+template <unsigned BufferIdBits>
+constexpr typename BasicPointerMapper<BufferIdBits>::base_ptr_t
+    BasicPointerMapper<BufferIdBits>::NUMBER_ID_RANGES;
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
+
+/* Presets for the split between buffer id and offset.
+ * The sizes are given for 64-bit pointers.
+ */
+/* 65535 buffers of up to 2^48 bytes */
+using PointerMapper16_48 = BasicPointerMapper<16>;
+/* 2^24 - 1 buffers of up to 2^40 bytes */
+using PointerMapper24_40 = BasicPointerMapper<24>;
+/* 2^32 - 1 buffers of up to 2^32 bytes.
+ * Its chunk directory takes 512KB, allocated on the first allocation of
+ * each mapper, i.e, of each thread in thread-local mode.
+ */
+using PointerMapper32_32 = BasicPointerMapper<32>;
+
+/* Default layout
+ */
+using PointerMapper = PointerMapper16_48;
+
+#ifdef CODEPLAY_LEGACY_THREAD_LOCAL
+/**
+ * ThreadPointerMapper
+ *  Holds the PointerMapper of a thread. A mapper left by an exited thread
+ *  is reused if available. On thread exit, the mapper is destroyed if it
+ *  has no live buffers, otherwise it is abandoned so that the buffers can
+ *  still be used and freed from other threads; it is then destroyed when
+ *  another thread frees its last buffer, unless a new thread adopted it.
+ */
+template <typename PointerMapperT>
+class ThreadPointerMapper {
+ public:
+  ThreadPointerMapper()
+      : m_mapper{PointerMapperT::get_registry().adopt()} {
+    if (m_mapper == nullptr) {
+      m_mapper = new PointerMapperT();
+    }
+  }
+
+  ThreadPointerMapper(const ThreadPointerMapper &) = delete;
+
+  ~ThreadPointerMapper() { PointerMapperT::get_registry().retire(m_mapper); }
+
+  PointerMapperT &get() { return *m_mapper; }
+
+ private:
+  PointerMapperT *m_mapper;
 };
 
+/**
+ * Per-thread interface to the pointer mapper to implement
+ * the generic malloc/free C interface without extra
+ * parameters. Each thread allocates from its own mapper, while
+ * pointers can be looked up and freed from any thread.
+ */
+template <typename PointerMapperT = PointerMapper>
+inline PointerMapperT &getPointerMapper() {
+  static thread_local ThreadPointerMapper<PointerMapperT> thePointerMapper;
+  return thePointerMapper.get();
+}
+#else
 /**
  * Singleton interface to the pointer mapper to implement
  * the generic malloc/free C interface without extra
  * parameters.
  */
-inline PointerMapper &getPointerMapper() {
-  static PointerMapper thePointerMapper;
+template <typename PointerMapperT = PointerMapper>
+inline PointerMapperT &getPointerMapper() {
+  static PointerMapperT thePointerMapper;
   return thePointerMapper;
 }
+#endif  // CODEPLAY_LEGACY_THREAD_LOCAL
 
 /**
  * Malloc-like interface to the pointer-mapper.
  * Given a size, creates a byte-typed buffer and returns a
  * fake pointer to keep track of it.
  */
+template <typename PointerMapperT = PointerMapper>
 inline void *malloc(size_t size) {
   // Create a generic buffer of the given size
-  auto thePointer = getPointerMapper().add_pointer(
-      PointerMapper::buffer_t(cl::sycl::range<1>{size}));
+  auto thePointer = getPointerMapper<PointerMapperT>().add_pointer(
+      typename PointerMapperT::buffer_t(cl::sycl::range<1>{size}));
   // Store the buffer on the global list
   return static_cast<void *>(thePointer);
 }
@@ -238,12 +747,29 @@ inline void *malloc(size_t size) {
  * Given a fake-pointer created with the legacy-pointer malloc,
  * destroys the buffer and remove it from the list.
  */
-inline void free(void *ptr) { getPointerMapper().remove_pointer(ptr); }
+template <typename PointerMapperT = PointerMapper>
+inline void free(void *ptr) {
+  getPointerMapper<PointerMapperT>().remove_pointer(ptr);
+}
 
 /**
  *clear the pointer list
  */
-inline void clear() { getPointerMapper().clear(); }
+template <typename PointerMapperT = PointerMapper>
+inline void clear() {
+  getPointerMapper<PointerMapperT>().clear();
+}
+
+/* Non-template overloads for the default layout, so that code taking the
+ * address of the functions keeps working.
+ */
+inline void *malloc(size_t size) { return malloc<PointerMapper>(size); }
+
+inline void free(void *ptr) { free<PointerMapper>(ptr); }
+
+inline void clear() { clear<PointerMapper>(); }
 
 }  // legacy
 }  // codeplay
+
+#endif  // CODEPLAY_LEGACY_POINTER
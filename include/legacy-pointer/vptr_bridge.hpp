@@ -0,0 +1,155 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  vptr_bridge.hpp
+ *
+ *  Description:
+ *    Exchange of buffers between the legacy pointer and the virtual
+ *    pointer mappers without copying their contents
+ *
+ **************************************************************************/
+
+#include <CL/sycl.hpp>
+
+#ifndef CODEPLAY_LEGACY_VPTR_BRIDGE
+#define CODEPLAY_LEGACY_VPTR_BRIDGE
+
+#include "legacy-pointer/legacy_pointer.hpp"
+#include "vptr/virtual_ptr.hpp"
+
+namespace codeplay {
+namespace legacy {
+
+/* Mapper of the virtual pointers
+ */
+using vptr_mapper_t = cl::sycl::codeplay::PointerMapper;
+
+/* Element and allocator types of a buffer type, used to obtain the legacy
+ * buffer type from the virtual pointer mapper.
+ */
+template <typename BufferT>
+struct buffer_types;
+
+template <typename T, int Dims, typename AllocatorT>
+struct buffer_types<cl::sycl::buffer<T, Dims, AllocatorT>> {
+  using data_type = T;
+  using allocator_type = AllocatorT;
+};
+
+/**
+ * Registers the buffer of a legacy pointer in a virtual pointer mapper.
+ * No data is copied: both pointers refer to the same SYCL buffer.
+ * Each mapper holds its own reference to the buffer, so each pointer must be
+ * freed with its own interface, in any order. The virtual pointer mapper
+ * keeps its reference after the virtual pointer is freed, until the freed
+ * node is reused, fused with a neighbour or erased, so the storage may
+ * outlive both pointers until then.
+ * \param ptr Legacy pointer, possibly with an offset
+ * \param vMap Virtual pointer mapper that receives the buffer
+ * \param lMap Legacy pointer mapper that owns ptr
+ * \return The virtual pointer with the same offset as ptr
+ * \throws std::out_of_range if the virtual address space is exhausted
+ */
+template <typename PointerMapperT = PointerMapper>
+inline void *share_with_vptr(
+    void *ptr, vptr_mapper_t &vMap,
+    PointerMapperT &lMap = getPointerMapper<PointerMapperT>()) {
+  auto b = lMap.get_buffer(lMap.get_buffer_id(ptr));
+  auto vBase = vMap.add_pointer(b);
+  auto offset = static_cast<size_t>(lMap.get_offset(ptr));
+  return static_cast<void *>(vBase + offset);
+}
+
+/**
+ * Registers the buffer of a virtual pointer in a legacy pointer mapper.
+ * No data is copied: both pointers refer to the same SYCL buffer.
+ * Each mapper holds its own reference to the buffer, so each pointer must be
+ * freed with its own interface, in any order. The virtual pointer mapper
+ * keeps its reference after the virtual pointer is freed, until the freed
+ * node is reused, fused with a neighbour or erased, so the storage may
+ * outlive both pointers until then.
+ * \param ptr Virtual pointer, possibly with an offset
+ * \param vMap Virtual pointer mapper that owns ptr
+ * \param lMap Legacy pointer mapper that receives the buffer
+ * \return The legacy pointer with the same offset as ptr, or a null pointer
+ *         if all the buffer ids are in use or the buffer is too large for
+ *         the pointer layout
+ * \throws std::out_of_range if ptr is not registered in vMap
+ */
+template <typename PointerMapperT = PointerMapper>
+inline void *share_from_vptr(
+    void *ptr, vptr_mapper_t &vMap,
+    PointerMapperT &lMap = getPointerMapper<PointerMapperT>()) {
+  using buffer_t = typename PointerMapperT::buffer_t;
+  using base_ptr_t = typename PointerMapperT::base_ptr_t;
+  using types_t = buffer_types<buffer_t>;
+
+  buffer_t b = vMap.get_buffer<typename types_t::allocator_type,
+                               typename types_t::data_type>(ptr);
+  if (b.get_count() > PointerMapperT::MAX_OFFSET) {
+    return nullptr;
+  }
+  auto offset = static_cast<base_ptr_t>(vMap.get_offset(ptr));
+
+  auto lBase = lMap.add_pointer(std::move(b));
+  if (PointerMapperT::is_nullptr(lBase)) {
+    return nullptr;
+  }
+  return reinterpret_cast<void *>(static_cast<base_ptr_t>(lBase) + offset);
+}
+
+/**
+ * Transfers the buffer of a legacy pointer to a virtual pointer mapper.
+ * The legacy pointer is freed and must not be used afterwards.
+ * \return The virtual pointer with the same offset as ptr
+ * \throws std::out_of_range if the virtual address space is exhausted, in
+ *         which case the legacy pointer is left untouched
+ */
+template <typename PointerMapperT = PointerMapper>
+inline void *move_to_vptr(
+    void *ptr, vptr_mapper_t &vMap,
+    PointerMapperT &lMap = getPointerMapper<PointerMapperT>()) {
+  void *vPtr = share_with_vptr(ptr, vMap, lMap);
+  lMap.remove_pointer(ptr);
+  return vPtr;
+}
+
+/**
+ * Transfers the buffer of a virtual pointer to a legacy pointer mapper.
+ * The virtual pointer is freed and must not be used afterwards, unless the
+ * transfer fails, in which case a null pointer is returned and the virtual
+ * pointer is left untouched.
+ * \return The legacy pointer with the same offset as ptr
+ */
+template <typename PointerMapperT = PointerMapper>
+inline void *move_from_vptr(
+    void *ptr, vptr_mapper_t &vMap,
+    PointerMapperT &lMap = getPointerMapper<PointerMapperT>()) {
+  void *lPtr = share_from_vptr(ptr, vMap, lMap);
+  if (lPtr != nullptr) {
+    cl::sycl::codeplay::SYCLfree(ptr, vMap);
+  }
+  return lPtr;
+}
+
+}  // legacy
+}  // codeplay
+
+#endif  // CODEPLAY_LEGACY_VPTR_BRIDGE
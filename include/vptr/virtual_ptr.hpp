@@ -32,7 +32,12 @@
 
 #include <CL/sycl.hpp>
 
+#ifndef CL_SYCL_VIRTUAL_PTR
+#define CL_SYCL_VIRTUAL_PTR
+
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <queue>
 #include <set>
 #include <stdexcept>
@@ -64,6 +69,26 @@ class PointerMapper {
  public:
   using base_ptr_t = std::uintptr_t;
 
+  /* Integer type able to hold every address issued by the mapper.
+   * When CODEPLAY_VPTR_32BIT_ADDRESS_SPACE is defined the virtual address
+   * space is restricted to 32 bits, so virtual pointers can be stored on the
+   * device (e.g, inside pointer-based data structures) using half the space.
+   */
+#ifdef CODEPLAY_VPTR_32BIT_ADDRESS_SPACE
+  using compressed_ptr_t = std::uint32_t;
+#else
+  using compressed_ptr_t = base_ptr_t;
+#endif  // CODEPLAY_VPTR_32BIT_ADDRESS_SPACE
+
+  /**
+   * Returns the highest address that can be issued by the mapper.
+   * The end of every allocation (i.e, the address one past its last byte)
+   * is guaranteed to be below or equal to this value.
+   */
+  static constexpr base_ptr_t max_address() {
+    return std::numeric_limits<compressed_ptr_t>::max();
+  }
+
   /* Structure of a virtual pointer
    *
    * |================================================|
@@ -145,6 +170,25 @@ class PointerMapper {
     return (static_cast<void *>(ptr) == nullptr);
   }
 
+  /**
+   * Returns the compressed representation of the given virtual pointer.
+   * \param ptr The virtual pointer to compress
+   * \throws std::out_of_range if the pointer is outside of the address space
+   */
+  static inline compressed_ptr_t compress(virtual_pointer_t ptr) {
+    if (static_cast<base_ptr_t>(ptr) > max_address()) {
+      throw std::out_of_range("The pointer is outside of the address space");
+    }
+    return static_cast<compressed_ptr_t>(static_cast<base_ptr_t>(ptr));
+  }
+
+  /**
+   * Recovers a virtual pointer from its compressed representation.
+   */
+  static inline virtual_pointer_t decompress(compressed_ptr_t ptr) {
+    return virtual_pointer_t(static_cast<base_ptr_t>(ptr));
+  }
+
   /* basic type for all buffers
    */
   using buffer_t = cl::sycl::buffer_mem;
@@ -300,6 +344,10 @@ class PointerMapper {
     if (m_baseAddress == 0) {
       throw std::invalid_argument(std::string("Base address cannot be zero"));
     }
+    if (m_baseAddress > max_address()) {
+      throw std::invalid_argument(
+          std::string("Base address is outside of the address space"));
+    }
   };
 
   /**
@@ -420,6 +468,7 @@ class PointerMapper {
     // If this is the first pointer:
     if (m_pointerMap.empty()) {
       virtual_pointer_t initialVal{m_baseAddress};
+      check_address_space(initialVal, bufSize);
       m_pointerMap.emplace(initialVal, p);
       return initialVal;
     }
@@ -450,11 +499,23 @@ class PointerMapper {
     } else {
       size_t lastSize = lastElemIter->second.m_size;
       retVal = lastElemIter->first + lastSize;
+      check_address_space(retVal, bufSize);
       m_pointerMap.emplace(retVal, p);
     }
     return retVal;
   }
 
+  /**
+   * Ensures that an allocation of the given size starting at ptr fits
+   * in the virtual address space.
+   * \throws std::out_of_range if the allocation would overflow it
+   */
+  static inline void check_address_space(virtual_pointer_t ptr, size_t size) {
+    if (size > max_address() - static_cast<base_ptr_t>(ptr)) {
+      throw std::out_of_range("The virtual address space is exhausted");
+    }
+  }
+
   /**
    * Compare two iterators to pointer map entries according to
    * the size of the allocation on the device.
@@ -528,3 +589,5 @@ inline void SYCLfreeAll(PointerMapper &pMap) {
 }  // codeplay
 }  // sycl
 }  // cl
+
+#endif  // CL_SYCL_VIRTUAL_PTR
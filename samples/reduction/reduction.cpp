@@ -28,148 +28,166 @@
 #include <CL/sycl.hpp>
 
 #include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <numeric>
 #include <random>
+#include <tuple>
 #include <vector>
 
-/* Implements a reduction of an STL vector using SYCL.
- * The input vector is not modified. */
+#include "reduction.hpp"
+
 template <typename T>
-T sycl_reduce(const std::vector<T>& v) {
-  T retVal;
+using reduce_fn = std::function<T(cl::sycl::queue&, cl::sycl::buffer<T, 1>&)>;
+
+/* Implements a reduction of an STL vector with `Op` using SYCL, and returns
+ * 0 if it matches the reduction by the standard library, a nonzero value
+ * otherwise. The input vector is not modified. */
+template <typename T, typename Op>
+int test_reduce(cl::sycl::queue& q, const std::vector<T>& v,
+                reduce_fn<T> reduce_op) {
+  T resSycl;
   {
-    cl::sycl::queue q([=](cl::sycl::exception_list eL) {
-      try {
-        for (auto& e : eL) {
-          std::rethrow_exception(e);
-        }
-      } catch (cl::sycl::exception ex) {
-        std::cout << " There is an exception in the reduction kernel"
-                  << std::endl;
-        std::cout << ex.what() << std::endl;
-      }
-    });
-
-    /* Output device and platform information. */
-    auto device = q.get_device();
-    auto deviceName = device.get_info<cl::sycl::info::device::name>();
-    std::cout << " Device Name: " << deviceName << std::endl;
-    auto platformName =
-        device.get_platform().get_info<cl::sycl::info::platform::name>();
-    std::cout << " Platform Name " << platformName << std::endl;
-
     /* The buffer is used to initialise the data on the device, but we don't
      * want to copy back and trash it. buffer::set_final_data() tells the
      * SYCL runtime where to put the data when the buffer is destroyed; nullptr
-     * indicates not to copy back. The vector's length is used as the global
-     * work size (unless that is too large). */
-    cl::sycl::buffer<int, 1> bufI(v.data(), cl::sycl::range<1>(v.size()));
+     * indicates not to copy back. */
+    cl::sycl::buffer<T, 1> bufI(v.data(), cl::sycl::range<1>(v.size()));
     bufI.set_final_data(nullptr);
-    size_t local = std::min(
-        v.size(),
-        device.get_info<cl::sycl::info::device::max_work_group_size>());
-    size_t length = v.size();
-
-    {
-      /* Each iteration of the do loop applies one level of reduction until
-       * the input is of length 1 (i.e. the reduction is complete). */
-      do {
-        auto f = [length, local, &bufI](cl::sycl::handler& h) mutable {
-          cl::sycl::nd_range<1> r{cl::sycl::range<1>{std::max(length, local)},
-                                  cl::sycl::range<1>{std::min(length, local)}};
-
-          /* Two accessors are used: one to the buffer that is being reduced,
-           * and a second to local memory, used to store intermediate data. */
-          auto aI =
-              bufI.template get_access<cl::sycl::access::mode::read_write>(h);
-          cl::sycl::accessor<T, 1, cl::sycl::access::mode::read_write,
-                             cl::sycl::access::target::local>
-              scratch(cl::sycl::range<1>(local), h);
-
-          /* The parallel_for invocation chosen is the variant with an nd_item
-           * parameter, since the code requires barriers for correctness. */
-          h.parallel_for<class sycl_reduction>(
-              r, [aI, scratch, local, length](cl::sycl::nd_item<1> id) {
-                size_t globalid = id.get_global(0);
-                size_t localid = id.get_local(0);
-
-                /* All threads collectively read from global memory into local.
-                 * The barrier ensures all threads' IO is resolved before
-                 * execution continues (strictly speaking, all threads within
-                 * a single work-group - there is no co-ordination between
-                 * work-groups, only work-items). */
-                if (globalid < length) {
-                  scratch[localid] = aI[globalid];
-                }
-                id.barrier(cl::sycl::access::fence_space::local_space);
-
-                /* Apply the reduction operation between the current local
-                 * id and the one on the other half of the vector. */
-                if (globalid < length) {
-                  int min = (length < local) ? length : local;
-                  for (size_t offset = min / 2; offset > 0; offset /= 2) {
-                    if (localid < offset) {
-                      scratch[localid] += scratch[localid + offset];
-                    }
-                    id.barrier(cl::sycl::access::fence_space::local_space);
-                  }
-                  /* The final result will be stored in local id 0. */
-                  if (localid == 0) {
-                    aI[id.get_group(0)] = scratch[localid];
-                  }
-                }
-              });
-        };
-        q.submit(f);
-        /* At this point, you could queue::wait_and_throw() to ensure that
-         * errors are caught quickly. However, this would likely impact
-         * performance negatively. */
-        length = length / local;
-      } while (length > 1);
-    }
+    resSycl = reduce_op(q, bufI);
+  }
 
-    {
-      /* It is always sensible to wrap host accessors in their own scope as
-       * kernels using the buffers they access are blocked for the length
-       * of the accessor's lifetime. */
-      auto hI =
-          bufI.template get_access<cl::sycl::access::mode::read,
-                                   cl::sycl::access::target::host_buffer>();
-      retVal = hI[0];
-    }
+  T resStl = std::accumulate(std::begin(v), std::end(v),
+                             T(reduction_identity<T, Op>::value), Op());
+  if (resSycl != resStl) {
+    std::cout << "SYCL Reduction result: " << resSycl << std::endl;
+    std::cout << " STL Reduction result: " << resStl << std::endl;
+    std::cout << " for size " << v.size() << std::endl;
+    return 1;
   }
-  return retVal;
+  return 0;
 }
 
-bool isPowerOfTwo(unsigned int x) {
-  /* If x is a power of two, x & (x - 1) will be nonzero. */
-  return ((x != 0) && !(x & (x - 1)));
+/* Computes the sum, minimum, maximum, count and sum of squares of an STL
+ * vector with a single fused reduction, and returns 0 if they match the
+ * ones computed by the standard library, a nonzero value otherwise. */
+int test_reduce_fused(cl::sycl::queue& q, const std::vector<int>& v) {
+  std::tuple<int64_t, int, int, size_t, int64_t> resSycl;
+  {
+    cl::sycl::buffer<int, 1> bufI(v.data(), cl::sycl::range<1>(v.size()));
+    bufI.set_final_data(nullptr);
+    resSycl = reduce_fused<int, sum_statistic<int64_t>, min_statistic<int>,
+                           max_statistic<int>, count_statistic<size_t>,
+                           sum_of_squares_statistic<int64_t>>(q, bufI);
+  }
+
+  int64_t sum = 0;
+  int64_t sumSq = 0;
+  for (int x : v) {
+    sum += x;
+    sumSq += int64_t(x) * x;
+  }
+  auto minMax = std::minmax_element(v.begin(), v.end());
+  auto resStl = std::make_tuple(sum, *minMax.first, *minMax.second, v.size(),
+                                sumSq);
+  if (resSycl != resStl) {
+    std::cout << "SYCL fused reduction incorrect for size " << v.size()
+              << std::endl;
+    return 1;
+  }
+
+  double mean = double(sum) / v.size();
+  double variance = double(sumSq) / v.size() - mean * mean;
+  std::cout << " Size " << v.size() << ": mean " << mean << ", variance "
+            << variance << ", min " << std::get<1>(resSycl) << ", max "
+            << std::get<2>(resSycl) << std::endl;
+  return 0;
 }
 
 int main() {
   std::cout << " SYCL Sample code: " << std::endl;
   std::cout << "   Reduction of an STL vector " << std::endl;
-  const unsigned N = 128u;
-  if (!isPowerOfTwo(N)) {
-    std::cout << "The SYCL reduction example "
-              << "only works with vector sizes Power of Two " << std::endl;
-    return 1;
-  }
+
+  cl::sycl::queue q([=](cl::sycl::exception_list eL) {
+    try {
+      for (auto& e : eL) {
+        std::rethrow_exception(e);
+      }
+    } catch (cl::sycl::exception ex) {
+      std::cout << " There is an exception in the reduction kernel"
+                << std::endl;
+      std::cout << ex.what() << std::endl;
+    }
+  });
+
+  /* Output device and platform information. */
+  auto device = q.get_device();
+  auto deviceName = device.get_info<cl::sycl::info::device::name>();
+  std::cout << " Device Name: " << deviceName << std::endl;
+  auto platformName =
+      device.get_platform().get_info<cl::sycl::info::platform::name>();
+  std::cout << " Platform Name " << platformName << std::endl;
+
+  /* The reduction objects are built once and reused for every input, by the
+   * last function of each list. */
+  reduction<int, std::plus<int>> sum_reduction(q);
+  reduction<int, minimum<int>> min_reduction(q);
+  reduction<int, maximum<int>> max_reduction(q);
+  reduction<int64_t, std::multiplies<int64_t>> product_reduction(q);
+
+  reduce_fn<int> sum_reduces[] = {
+      reduce<int, std::plus<int>>, reduce_grid_stride<int, std::plus<int>>,
+      [&](cl::sycl::queue&, cl::sycl::buffer<int, 1>& b) {
+        return sum_reduction(b);
+      }};
+  reduce_fn<int> min_reduces[] = {
+      reduce<int, minimum<int>>, reduce_grid_stride<int, minimum<int>>,
+      [&](cl::sycl::queue&, cl::sycl::buffer<int, 1>& b) {
+        return min_reduction(b);
+      }};
+  reduce_fn<int> max_reduces[] = {
+      reduce<int, maximum<int>>, reduce_grid_stride<int, maximum<int>>,
+      [&](cl::sycl::queue&, cl::sycl::buffer<int, 1>& b) {
+        return max_reduction(b);
+      }};
+  reduce_fn<int64_t> product_reduces[] = {
+      reduce<int64_t, std::multiplies<int64_t>>,
+      reduce_grid_stride<int64_t, std::multiplies<int64_t>>,
+      [&](cl::sycl::queue&, cl::sycl::buffer<int64_t, 1>& b) {
+        return product_reduction(b);
+      }};
 
   std::random_device hwRand;
   std::ranlux48 rand(hwRand());
   std::uniform_int_distribution<int> dist(0, 10);
-  auto f = std::bind(dist, rand);
-
-  std::vector<int> v(N);
-  std::generate(v.begin(), v.end(), f);
 
-  auto resSycl = sycl_reduce(v);
-  std::cout << "SYCL Reduction result: " << resSycl << std::endl;
-
-  auto resStl = std::accumulate(std::begin(v), std::end(v), 0);
-  std::cout << " STL Reduction result: " << resStl << std::endl;
+  /* Powers of two fill every work-group, the other sizes leave the last one
+   * partially covered at some level of the reduction. */
+  for (size_t size : {128, 1, 3, 1000, 1000003}) {
+    std::vector<int> v(size);
+    std::generate(v.begin(), v.end(), [&] { return dist(rand); });
+    // At most 40 factors of 1 or 2, so the product fits in an int64_t.
+    std::vector<int64_t> factors(std::min<size_t>(size, 40));
+    std::transform(v.begin(), v.begin() + factors.size(), factors.begin(),
+                   [](int x) { return int64_t(x % 2 + 1); });
+
+    for (size_t i = 0; i < 3; i++) {
+      int ret = test_reduce<int, std::plus<int>>(q, v, sum_reduces[i]);
+      ret |= test_reduce<int, minimum<int>>(q, v, min_reduces[i]);
+      ret |= test_reduce<int, maximum<int>>(q, v, max_reduces[i]);
+      ret |= test_reduce<int64_t, std::multiplies<int64_t>>(
+          q, factors, product_reduces[i]);
+      if (ret != 0) {
+        return ret;
+      }
+    }
+    int ret = test_reduce_fused(q, v);
+    if (ret != 0) {
+      return ret;
+    }
+  }
 
-  return (resSycl != resStl);
+  std::cout << " Results are correct." << std::endl;
+  return 0;
 }
@@ -0,0 +1,608 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2016 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  reduction.hpp
+ *
+ *  Description:
+ *    Parallel reduction algorithms in SYCL.
+ *
+ **************************************************************************/
+
+#ifndef INCLUDE_REDUCTION_HPP
+#define INCLUDE_REDUCTION_HPP
+
+#include <CL/sycl.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+
+// Operation returning the smaller of two values.
+template <typename T>
+struct minimum {
+  T operator()(const T& a, const T& b) const { return (b < a) ? b : a; }
+};
+
+// Operation returning the larger of two values.
+template <typename T>
+struct maximum {
+  T operator()(const T& a, const T& b) const { return (a < b) ? b : a; }
+};
+
+// The identity element of a given reduction operation.
+template <typename T, typename Op>
+struct reduction_identity {};
+
+template <typename T>
+struct reduction_identity<T, std::plus<T>> {
+  static constexpr T value = 0;
+};
+
+template <typename T>
+struct reduction_identity<T, std::multiplies<T>> {
+  static constexpr T value = 1;
+};
+
+template <typename T>
+struct reduction_identity<T, minimum<T>> {
+  static constexpr T value = std::numeric_limits<T>::has_infinity
+                                 ? std::numeric_limits<T>::infinity()
+                                 : std::numeric_limits<T>::max();
+};
+
+template <typename T>
+struct reduction_identity<T, maximum<T>> {
+  static constexpr T value = std::numeric_limits<T>::has_infinity
+                                 ? -std::numeric_limits<T>::infinity()
+                                 : std::numeric_limits<T>::lowest();
+};
+
+template <typename T>
+struct reduction_identity<T, std::logical_or<T>> {
+  static constexpr T value = false;
+};
+
+template <typename T>
+struct reduction_identity<T, std::logical_and<T>> {
+  static constexpr T value = true;
+};
+
+// Kernel names of the reductions.
+template <typename T, typename Op>
+class reduce_level;
+template <typename T, typename Op>
+class reduce_grid;
+template <typename T, typename Op>
+class reduce_fused_grid;
+
+template <typename T>
+using reduction_local_accessor =
+    cl::sycl::accessor<T, 1, cl::sycl::access::mode::read_write,
+                       cl::sycl::access::target::local>;
+
+/* Checks that the device associated with the given queue can reduce an input
+ * of `in_size` elements, and returns the work-group size to use, a power of
+ * two with room for `local_elems_per_item` elements of type T per work-item
+ * in local memory. The size is shrunk for inputs too small to need a whole
+ * work-group. If `kernel` is given, the size is also limited to the largest
+ * work-group it can be launched with on the device, which can be smaller than
+ * the device maximum. */
+template <typename T>
+size_t reduce_wgroup_size(cl::sycl::queue& q, size_t in_size,
+                          size_t local_elems_per_item = 1,
+                          const cl::sycl::kernel* kernel = nullptr) {
+  auto dev = q.get_device();
+
+  /* Check if local memory is available. On host no local memory is fine, since
+   * it is emulated. */
+  if (!dev.is_host() &&
+      dev.get_info<cl::sycl::info::device::local_mem_type>() ==
+          cl::sycl::info::local_mem_type::none) {
+    throw std::runtime_error("Device does not have local memory.");
+  }
+
+  size_t max_wgroup_size =
+      dev.get_info<cl::sycl::info::device::max_work_group_size>();
+  if (kernel != nullptr) {
+    max_wgroup_size = std::min(
+        max_wgroup_size,
+        kernel->get_work_group_info<
+            cl::sycl::info::kernel_work_group::work_group_size>(dev));
+  }
+  size_t local_mem_size =
+      dev.get_info<cl::sycl::info::device::local_mem_size>();
+
+  /* The reduction tree needs a power-of-two work-group size. Find the largest
+   * one below the maximum work-group size of the device that fits in local
+   * memory. */
+  size_t wgroup_size = 1;
+  while (wgroup_size * 2 <= max_wgroup_size) {
+    wgroup_size *= 2;
+  }
+  while (wgroup_size > 0 &&
+         wgroup_size * local_elems_per_item * sizeof(T) > local_mem_size) {
+    wgroup_size >>= 1;
+  }
+  if (wgroup_size == 0) {
+    throw std::runtime_error(
+        "Could not find an appropriate work-group size for the given input.");
+  }
+
+  // Shrink the work-group while half of it still covers the input.
+  while (wgroup_size > 1 && wgroup_size / 2 >= in_size) {
+    wgroup_size >>= 1;
+  }
+  return wgroup_size;
+}
+
+/* Reduces the `wgroup_size` elements in `scratch` with `Op`, leaving the
+ * result in `scratch[0]`. Has to be called by every work-item of the
+ * work-group once they have stored their element, and only the first
+ * work-item may read the result. */
+template <typename T, typename Op>
+void work_group_reduce(cl::sycl::nd_item<1>& item,
+                       const reduction_local_accessor<T>& scratch,
+                       size_t wgroup_size) {
+  size_t lid = item.get_local_linear_id();
+  Op op;
+  /* Apply the reduction operation between the element of the current local
+   * id and the one on the other half of the remaining elements. The barrier
+   * makes the previous writes visible to the whole work-group. */
+  for (size_t offset = wgroup_size / 2; offset > 0; offset /= 2) {
+    item.barrier(cl::sycl::access::fence_space::local_space);
+    if (lid < offset) {
+      scratch[lid] = op(scratch[lid], scratch[lid + offset]);
+    }
+  }
+}
+
+/* Reduces each run of `2 * wgroup_size` elements of the first `length`
+ * elements of `in` with `Op`, writing the result of the i-th run to `out[i]`.
+ * Every work-item combines two elements as it loads them, so each level
+ * shrinks the input even for single work-item work-groups. The last run may
+ * be partial; the missing elements count as the identity. */
+template <typename T, typename Op>
+void par_reduce_level(cl::sycl::queue& q, cl::sycl::buffer<T, 1>& in,
+                      cl::sycl::buffer<T, 1>& out, size_t length,
+                      size_t wgroup_size) {
+  size_t n_groups = (length + 2 * wgroup_size - 1) / (2 * wgroup_size);
+  q.submit([&](cl::sycl::handler& h) {
+    auto aI = in.template get_access<cl::sycl::access::mode::read>(h);
+    auto aO = out.template get_access<cl::sycl::access::mode::write>(h);
+    reduction_local_accessor<T> scratch(cl::sycl::range<1>(wgroup_size), h);
+
+    h.parallel_for<reduce_level<T, Op>>(
+        cl::sycl::nd_range<1>(n_groups * wgroup_size, wgroup_size),
+        [=](cl::sycl::nd_item<1> item) {
+          size_t localid = item.get_local_linear_id();
+          size_t first = item.get_group_linear_id() * 2 * wgroup_size + localid;
+          size_t second = first + wgroup_size;
+          const T ident = reduction_identity<T, Op>::value;
+
+          T x = (first < length) ? aI[first] : ident;
+          T y = (second < length) ? aI[second] : ident;
+          scratch[localid] = Op()(x, y);
+          work_group_reduce<T, Op>(item, scratch, wgroup_size);
+
+          if (localid == 0) {
+            aO[item.get_group_linear_id()] = scratch[0];
+          }
+        });
+  });
+}
+
+/* Reduces the elements of the `in` buffer with the associative and
+ * commutative operation `Op` on the device associated with the given queue,
+ * and returns the result, or the identity of `Op` for an empty buffer. Each
+ * level of the reduction reduces the elements of every work-group, two per
+ * work-item, to one, until a single one is left; the partial results go to
+ * temporary buffers and `in` is not modified. */
+template <typename T, typename Op>
+T reduce(cl::sycl::queue& q, cl::sycl::buffer<T, 1>& in) {
+  size_t length = in.get_count();
+  if (length == 0) {
+    return reduction_identity<T, Op>::value;
+  }
+
+  size_t wgroup_size = reduce_wgroup_size<T>(q, (length + 1) / 2);
+  auto n_groups = [&](size_t n) {
+    return (n + 2 * wgroup_size - 1) / (2 * wgroup_size);
+  };
+
+  /* The levels alternate between two buffers of partial results, the first
+   * one large enough for the first level. */
+  cl::sycl::buffer<T, 1> partials_a{cl::sycl::range<1>(n_groups(length))};
+  cl::sycl::buffer<T, 1> partials_b{
+      cl::sycl::range<1>(n_groups(n_groups(length)))};
+  cl::sycl::buffer<T, 1>* src = &in;
+  cl::sycl::buffer<T, 1>* dst = &partials_a;
+
+  do {
+    // The last levels only need part of the work-group.
+    size_t level_wgroup_size = wgroup_size;
+    while (level_wgroup_size > 1 && level_wgroup_size >= length) {
+      level_wgroup_size >>= 1;
+    }
+    par_reduce_level<T, Op>(q, *src, *dst, length, level_wgroup_size);
+    length = (length + 2 * level_wgroup_size - 1) / (2 * level_wgroup_size);
+    src = dst;
+    dst = (dst == &partials_a) ? &partials_b : &partials_a;
+  } while (length > 1);
+
+  // The host accessor waits for the last level to complete.
+  auto hI = src->template get_access<cl::sycl::access::mode::read,
+                                     cl::sycl::access::target::host_buffer>();
+  return hI[0];
+}
+
+/* Reduces the first `length` elements of `in` with `Op` using `n_groups`
+ * work-groups of `wgroup_size` work-items, writing the result of the i-th
+ * work-group to `out[i]`. Every work-item first reduces the elements a whole
+ * grid apart in private memory, so any number of elements takes a single
+ * launch. The kernel, if given, is the one of `reduce_grid<T, Op>` built
+ * ahead of time. */
+template <typename T, typename Op>
+void par_reduce_grid_stride(cl::sycl::queue& q, cl::sycl::buffer<T, 1>& in,
+                            cl::sycl::buffer<T, 1>& out, size_t length,
+                            size_t n_groups, size_t wgroup_size,
+                            const cl::sycl::kernel* kernel = nullptr) {
+  q.submit([&](cl::sycl::handler& h) {
+    auto aI = in.template get_access<cl::sycl::access::mode::read>(h);
+    auto aO = out.template get_access<cl::sycl::access::mode::write>(h);
+    reduction_local_accessor<T> scratch(cl::sycl::range<1>(wgroup_size), h);
+
+    cl::sycl::nd_range<1> r(n_groups * wgroup_size, wgroup_size);
+    auto body = [=](cl::sycl::nd_item<1> item) {
+      size_t localid = item.get_local_linear_id();
+      size_t grid_size = item.get_global_range(0);
+      Op op;
+
+      T acc = reduction_identity<T, Op>::value;
+      for (size_t i = item.get_global_linear_id(); i < length;
+           i += grid_size) {
+        acc = op(acc, aI[i]);
+      }
+      scratch[localid] = acc;
+      work_group_reduce<T, Op>(item, scratch, wgroup_size);
+
+      if (localid == 0) {
+        aO[item.get_group_linear_id()] = scratch[0];
+      }
+    };
+    if (kernel) {
+      h.parallel_for<reduce_grid<T, Op>>(*kernel, r, body);
+    } else {
+      h.parallel_for<reduce_grid<T, Op>>(r, body);
+    }
+  });
+}
+
+/* Number of work-groups of the first launch of `reduce_grid_stride`: a few
+ * per compute unit to keep the device busy, but no more than the input
+ * needs. */
+inline size_t reduce_grid_size(cl::sycl::queue& q, size_t length,
+                               size_t wgroup_size) {
+  const size_t groups_per_unit = 4;
+  size_t compute_units =
+      q.get_device().get_info<cl::sycl::info::device::max_compute_units>();
+  size_t needed = length / wgroup_size + (length % wgroup_size != 0);
+  return std::max<size_t>(std::min(compute_units * groups_per_unit, needed),
+                          1);
+}
+
+/* Reduces the elements of the `in` buffer like `reduce`, in two launches
+ * whatever their number: a fixed number of work-groups, sized from the
+ * compute units of the device, reduce a grid-stride share of the input
+ * each, and a single work-group reduces their results. The input is read
+ * once and the partial results fit in a small buffer. */
+template <typename T, typename Op>
+T reduce_grid_stride(cl::sycl::queue& q, cl::sycl::buffer<T, 1>& in) {
+  size_t length = in.get_count();
+  if (length == 0) {
+    return reduction_identity<T, Op>::value;
+  }
+
+  size_t wgroup_size = reduce_wgroup_size<T>(q, length);
+  size_t n_groups = reduce_grid_size(q, length, wgroup_size);
+  cl::sycl::buffer<T, 1> partials{cl::sycl::range<1>(n_groups)};
+  cl::sycl::buffer<T, 1> result{cl::sycl::range<1>(1)};
+
+  par_reduce_grid_stride<T, Op>(q, in, partials, length, n_groups,
+                                wgroup_size);
+  par_reduce_grid_stride<T, Op>(q, partials, result, n_groups, 1,
+                                reduce_wgroup_size<T>(q, n_groups));
+
+  auto hR = result.template get_access<cl::sycl::access::mode::read,
+                                       cl::sycl::access::target::host_buffer>();
+  return hR[0];
+}
+
+/* Reduction with `Op` of buffers of T on the device associated with a given
+ * queue, for programs running many reductions. Unlike `reduce_grid_stride`,
+ * which it otherwise follows, it builds the kernel, chooses the work-group
+ * size and allocates the buffers of partial results once, on construction,
+ * so that every call only launches the kernels and reads the result. Small
+ * inputs take a single launch. */
+template <typename T, typename Op>
+class reduction {
+ public:
+  explicit reduction(cl::sycl::queue& q)
+      : m_queue(q),
+        m_program(q.get_context()),
+        m_kernel(build_kernel(m_program)),
+        m_wgroup_size(reduce_wgroup_size<T>(
+            q, std::numeric_limits<size_t>::max(), 1, &m_kernel)),
+        m_max_groups(reduce_grid_size(q, std::numeric_limits<size_t>::max(),
+                                      m_wgroup_size)),
+        m_partials(cl::sycl::range<1>(m_max_groups)),
+        m_result(cl::sycl::range<1>(1)) {}
+
+  // Returns the reduction of the elements of `in`.
+  T operator()(cl::sycl::buffer<T, 1>& in) {
+    size_t length = in.get_count();
+    if (length == 0) {
+      return reduction_identity<T, Op>::value;
+    }
+
+    size_t n_groups = std::min(
+        m_max_groups,
+        length / m_wgroup_size + (length % m_wgroup_size != 0));
+
+    /* Inputs that fit in a single work-group, shrunk to their size, are
+     * reduced in a single launch. */
+    if (n_groups == 1) {
+      par_reduce_grid_stride<T, Op>(m_queue, in, m_result, length, 1,
+                                    fitting_wgroup_size(length), &m_kernel);
+    } else {
+      par_reduce_grid_stride<T, Op>(m_queue, in, m_partials, length, n_groups,
+                                    m_wgroup_size, &m_kernel);
+      par_reduce_grid_stride<T, Op>(m_queue, m_partials, m_result, n_groups,
+                                    1, fitting_wgroup_size(n_groups),
+                                    &m_kernel);
+    }
+
+    auto hR =
+        m_result.template get_access<cl::sycl::access::mode::read,
+                                     cl::sycl::access::target::host_buffer>();
+    return hR[0];
+  }
+
+ private:
+  // Smallest power of two work-group size covering `length` elements.
+  size_t fitting_wgroup_size(size_t length) const {
+    size_t wgroup_size = m_wgroup_size;
+    while (wgroup_size > 1 && wgroup_size / 2 >= length) {
+      wgroup_size >>= 1;
+    }
+    return wgroup_size;
+  }
+
+  static cl::sycl::kernel build_kernel(cl::sycl::program& program) {
+    program.template build_with_kernel_type<reduce_grid<T, Op>>();
+    return program.template get_kernel<reduce_grid<T, Op>>();
+  }
+
+  cl::sycl::queue m_queue;
+  cl::sycl::program m_program;
+  cl::sycl::kernel m_kernel;
+  size_t m_wgroup_size;
+  size_t m_max_groups;
+  cl::sycl::buffer<T, 1> m_partials;
+  cl::sycl::buffer<T, 1> m_result;
+};
+
+// Maps an element to itself, converted to U.
+template <typename U>
+struct convert_to {
+  template <typename T>
+  U operator()(const T& x) const {
+    return static_cast<U>(x);
+  }
+};
+
+// Maps an element to its square, computed in U.
+template <typename U>
+struct square_to {
+  template <typename T>
+  U operator()(const T& x) const {
+    U y = static_cast<U>(x);
+    return y * y;
+  }
+};
+
+// Maps every element to 1, for counting them.
+template <typename U>
+struct one_to {
+  template <typename T>
+  U operator()(const T&) const {
+    return U(1);
+  }
+};
+
+/* A statistic of a fused reduction: every element is mapped to a value of
+ * type U by `Map`, and the values are reduced with `Op`. */
+template <typename U, typename Op, typename Map = convert_to<U>>
+struct statistic {
+  using value_type = U;
+  using op_type = Op;
+  using map_type = Map;
+};
+
+template <typename U>
+using sum_statistic = statistic<U, std::plus<U>>;
+
+template <typename U>
+using min_statistic = statistic<U, minimum<U>>;
+
+template <typename U>
+using max_statistic = statistic<U, maximum<U>>;
+
+template <typename U>
+using count_statistic = statistic<U, std::plus<U>, one_to<U>>;
+
+template <typename U>
+using sum_of_squares_statistic = statistic<U, std::plus<U>, square_to<U>>;
+
+/* The values of a list of statistics, stored together so that a fused
+ * reduction keeps one struct per work-item in private and local memory. */
+template <typename... Stats>
+struct fused_values {};
+
+template <typename Stat, typename... Rest>
+struct fused_values<Stat, Rest...> {
+  typename Stat::value_type value;
+  fused_values<Rest...> rest;
+};
+
+/* The operation of a fused reduction, which maps an element to the values
+ * of every statistic and combines the values of each statistic with its own
+ * operation. */
+template <typename... Stats>
+struct fused_op {
+  using value_type = fused_values<>;
+
+  static constexpr value_type identity() { return value_type{}; }
+
+  template <typename T>
+  static value_type map(const T&) {
+    return value_type{};
+  }
+
+  value_type operator()(const value_type&, const value_type&) const {
+    return value_type{};
+  }
+
+  static std::tuple<> to_tuple(const value_type&) { return std::tuple<>(); }
+};
+
+template <typename Stat, typename... Rest>
+struct fused_op<Stat, Rest...> {
+  using value_type = fused_values<Stat, Rest...>;
+  using stat_type = typename Stat::value_type;
+
+  static constexpr value_type identity() {
+    return value_type{
+        reduction_identity<stat_type, typename Stat::op_type>::value,
+        fused_op<Rest...>::identity()};
+  }
+
+  template <typename T>
+  static value_type map(const T& x) {
+    value_type v;
+    v.value = typename Stat::map_type()(x);
+    v.rest = fused_op<Rest...>::map(x);
+    return v;
+  }
+
+  value_type operator()(const value_type& a, const value_type& b) const {
+    value_type v;
+    v.value = typename Stat::op_type()(a.value, b.value);
+    v.rest = fused_op<Rest...>()(a.rest, b.rest);
+    return v;
+  }
+
+  static std::tuple<stat_type, typename Rest::value_type...> to_tuple(
+      const value_type& v) {
+    return std::tuple_cat(std::make_tuple(v.value),
+                          fused_op<Rest...>::to_tuple(v.rest));
+  }
+};
+
+template <typename... Stats>
+struct reduction_identity<fused_values<Stats...>, fused_op<Stats...>> {
+  static constexpr fused_values<Stats...> value =
+      fused_op<Stats...>::identity();
+};
+
+template <typename... Stats>
+constexpr fused_values<Stats...>
+    reduction_identity<fused_values<Stats...>, fused_op<Stats...>>::value;
+
+/* Like `par_reduce_grid_stride`, but maps every element of `in` to the
+ * values of the statistics of the fused operation `Op` before reducing
+ * them, so the output holds one struct of values per work-group. */
+template <typename T, typename Op>
+void par_reduce_fused_grid_stride(
+    cl::sycl::queue& q, cl::sycl::buffer<T, 1>& in,
+    cl::sycl::buffer<typename Op::value_type, 1>& out, size_t length,
+    size_t n_groups, size_t wgroup_size) {
+  using V = typename Op::value_type;
+  q.submit([&](cl::sycl::handler& h) {
+    auto aI = in.template get_access<cl::sycl::access::mode::read>(h);
+    auto aO = out.template get_access<cl::sycl::access::mode::write>(h);
+    reduction_local_accessor<V> scratch(cl::sycl::range<1>(wgroup_size), h);
+
+    h.parallel_for<reduce_fused_grid<T, Op>>(
+        cl::sycl::nd_range<1>(n_groups * wgroup_size, wgroup_size),
+        [=](cl::sycl::nd_item<1> item) {
+          size_t localid = item.get_local_linear_id();
+          size_t grid_size = item.get_global_range(0);
+          Op op;
+
+          V acc = Op::identity();
+          for (size_t i = item.get_global_linear_id(); i < length;
+               i += grid_size) {
+            acc = op(acc, Op::map(aI[i]));
+          }
+          scratch[localid] = acc;
+          work_group_reduce<V, Op>(item, scratch, wgroup_size);
+
+          if (localid == 0) {
+            aO[item.get_group_linear_id()] = scratch[0];
+          }
+        });
+  });
+}
+
+/* Computes several statistics of the elements of the `in` buffer in a
+ * single read of the input, and returns them as a tuple in the order of
+ * `Stats`, e.g.
+ *   reduce_fused<float, sum_statistic<double>, min_statistic<float>>(q, in)
+ * returns the sum and the minimum. Like `reduce_grid_stride`, it takes two
+ * launches, the second reducing the structs of values of the work-groups of
+ * the first, and all the results come back in one host transfer. */
+template <typename T, typename... Stats>
+std::tuple<typename Stats::value_type...> reduce_fused(
+    cl::sycl::queue& q, cl::sycl::buffer<T, 1>& in) {
+  using Op = fused_op<Stats...>;
+  using V = typename Op::value_type;
+  size_t length = in.get_count();
+  if (length == 0) {
+    return Op::to_tuple(Op::identity());
+  }
+
+  size_t wgroup_size = reduce_wgroup_size<V>(q, length);
+  size_t n_groups = reduce_grid_size(q, length, wgroup_size);
+  cl::sycl::buffer<V, 1> partials{cl::sycl::range<1>(n_groups)};
+  cl::sycl::buffer<V, 1> result{cl::sycl::range<1>(1)};
+
+  par_reduce_fused_grid_stride<T, Op>(q, in, partials, length, n_groups,
+                                      wgroup_size);
+  par_reduce_grid_stride<V, Op>(q, partials, result, n_groups, 1,
+                                reduce_wgroup_size<V>(q, n_groups));
+
+  auto hR = result.template get_access<cl::sycl::access::mode::read,
+                                       cl::sycl::access::target::host_buffer>();
+  return Op::to_tuple(hR[0]);
+}
+
+#endif  // INCLUDE_REDUCTION_HPP
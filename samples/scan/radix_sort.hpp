@@ -0,0 +1,346 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  radix_sort.hpp
+ *
+ *  Description:
+ *    Parallel least significant digit radix sort in SYCL, built on the scan
+ *    algorithms of scan.hpp.
+ *
+ **************************************************************************/
+
+#ifndef INCLUDE_RADIX_SORT_HPP
+#define INCLUDE_RADIX_SORT_HPP
+
+#include "scan.hpp"
+
+#include <type_traits>
+#include <utility>
+
+// Value type of a radix sort of keys alone.
+struct no_values {};
+
+// Kernel names of par_radix_sort, for each number of bits per pass.
+template <unsigned Bits>
+class radix_histogram;
+template <unsigned Bits>
+class radix_scatter;
+template <unsigned Bits>
+class radix_copy_back;
+
+/* Performs one pass of the radix sort of the first `size` keys of `in_keys`
+ * and of their values, if `Value` is not `no_values`, into `out_keys` and
+ * `out_values`. The keys are ordered by their digit of `Bits` bits starting
+ * at bit `shift`, keeping the order of the keys with the same digit.
+ * Every work-group sorts `tiles_per_group` consecutive tiles of
+ * `2 * wgroup_size` keys:
+ *  - A first kernel counts the keys of each digit in the tiles of every
+ *    work-group, in local memory.
+ *  - The counts are stored digit by digit in `hist`, so that their exclusive
+ *    scan is the position of the first key of every digit and work-group.
+ *    It only holds `radix * n_groups` counts, so it is scanned with the
+ *    multi-pass `par_scan`, which runs on any device.
+ *  - A second kernel sorts each tile by the digit in local memory, one bit
+ *    at a time with `work_group_scan`, and writes every key at the position
+ *    of its digit plus its rank among the keys of the same digit. */
+template <typename Key, typename Value, unsigned Bits>
+void radix_sort_pass(sycl::queue& q, size_t size, size_t wgroup_size,
+                     size_t n_groups, size_t tiles_per_group, unsigned shift,
+                     sycl::buffer<Key, 1>& in_keys,
+                     sycl::buffer<Key, 1>& out_keys,
+                     sycl::buffer<Value, 1>& in_values,
+                     sycl::buffer<Value, 1>& out_values,
+                     sycl::buffer<size_t, 1>& hist) {
+  using layout = padded_layout<>;
+  constexpr bool with_values = !std::is_same<Value, no_values>::value;
+  constexpr unsigned key_bits = sizeof(Key) * 8;
+  constexpr size_t radix = size_t(1) << Bits;
+  const Key mask = static_cast<Key>(radix - 1);
+  size_t tile_size = 2 * wgroup_size;
+  size_t group_size = tile_size * tiles_per_group;
+
+  q.submit([&](sycl::handler& cgh) {
+    auto keys = in_keys.template get_access<sycl::access::mode::read>(cgh);
+    auto counts_out =
+        hist.template get_access<sycl::access::mode::discard_write>(cgh);
+    sycl::accessor<unsigned int, 1, sycl::access::mode::atomic,
+                   sycl::access::target::local>
+        counts(radix, cgh);
+
+    cgh.parallel_for<kernel_name<Key, Value, radix_histogram<Bits>>>(
+        sycl::nd_range<1>(n_groups * wgroup_size, wgroup_size),
+        [=](sycl::nd_item<1> item) {
+          size_t lid = item.get_local_linear_id();
+          size_t group = item.get_group_linear_id();
+
+          for (size_t d = lid; d < radix; d += wgroup_size) {
+            counts[d].store(0u);
+          }
+          item.barrier(sycl::access::fence_space::local_space);
+
+          size_t begin = group * group_size;
+          size_t end = sycl::min(begin + group_size, size);
+          for (size_t i = begin + lid; i < end; i += wgroup_size) {
+            counts[(keys[i] >> shift) & mask].fetch_add(1u);
+          }
+          item.barrier(sycl::access::fence_space::local_space);
+
+          for (size_t d = lid; d < radix; d += wgroup_size) {
+            counts_out[d * n_groups + group] = counts[d].load();
+          }
+        });
+  });
+
+  par_exclusive_scan<size_t, std::plus<size_t>, multi_pass_strategy>(hist, q);
+
+  q.submit([&](sycl::handler& cgh) {
+    auto src_keys = in_keys.template get_access<sycl::access::mode::read>(cgh);
+    auto dst_keys =
+        out_keys.template get_access<sycl::access::mode::write>(cgh);
+    auto src_values =
+        in_values.template get_access<sycl::access::mode::read>(cgh);
+    auto dst_values =
+        out_values.template get_access<sycl::access::mode::write>(cgh);
+    auto offsets = hist.template get_access<sycl::access::mode::read>(cgh);
+    local_accessor<Key> local_keys(tile_size, cgh);
+    local_accessor<Value> local_values(with_values ? tile_size : 1, cgh);
+    local_accessor<unsigned int> temp(layout::size(tile_size), cgh);
+    local_accessor<unsigned int> n_zeros(1, cgh);
+    local_accessor<unsigned int> digit_start(radix, cgh);
+    local_accessor<size_t> digit_offset(radix, cgh);
+
+    cgh.parallel_for<kernel_name<Key, Value, radix_scatter<Bits>>>(
+        sycl::nd_range<1>(n_groups * wgroup_size, wgroup_size),
+        [=](sycl::nd_item<1> item) {
+          size_t lid = item.get_local_linear_id();
+          size_t group = item.get_group_linear_id();
+
+          // Position of the next key of every digit of this work-group.
+          for (size_t d = lid; d < radix; d += wgroup_size) {
+            digit_offset[d] = offsets[d * n_groups + group];
+          }
+
+          for (size_t t = 0; t < tiles_per_group; t++) {
+            size_t tile_begin = group * group_size + t * tile_size;
+            if (tile_begin >= size) {
+              break;
+            }
+            size_t valid = sycl::min(tile_size, size - tile_begin);
+            item.barrier(sycl::access::fence_space::local_space);
+
+            /* Every work-item holds two keys of the tile. The positions past
+             * the end of the input hold keys with all their bits set, which
+             * stay after the valid keys through the stable sort. */
+            Key keys[2];
+            Value values[2];
+            for (size_t e = 0; e < 2; e++) {
+              size_t p = 2 * lid + e;
+              if (p < valid) {
+                keys[e] = src_keys[tile_begin + p];
+                if (with_values) {
+                  values[e] = src_values[tile_begin + p];
+                }
+              } else {
+                keys[e] = static_cast<Key>(~Key(0));
+              }
+            }
+
+            /* Sort the tile by the digit, one bit at a time: the keys with
+             * the bit cleared go first, at their rank among them given by
+             * an exclusive scan, and the others after them. */
+            for (unsigned b = 0; b < Bits && shift + b < key_bits; b++) {
+              unsigned int bits[2];
+              for (size_t e = 0; e < 2; e++) {
+                bits[e] = static_cast<unsigned int>((keys[e] >> (shift + b)) &
+                                                    Key(1));
+                temp[layout::index(2 * lid + e)] = 1u - bits[e];
+              }
+
+              work_group_scan<unsigned int, std::plus<unsigned int>, layout>(
+                  item, temp, wgroup_size);
+
+              if (lid == wgroup_size - 1) {
+                n_zeros[0] = temp[layout::index(tile_size - 1)] + 1u - bits[1];
+              }
+              item.barrier(sycl::access::fence_space::local_space);
+
+              for (size_t e = 0; e < 2; e++) {
+                size_t p = 2 * lid + e;
+                size_t zeros_before = temp[layout::index(p)];
+                size_t dest =
+                    bits[e] ? n_zeros[0] + (p - zeros_before) : zeros_before;
+                local_keys[dest] = keys[e];
+                if (with_values) {
+                  local_values[dest] = values[e];
+                }
+              }
+              item.barrier(sycl::access::fence_space::local_space);
+
+              for (size_t e = 0; e < 2; e++) {
+                keys[e] = local_keys[2 * lid + e];
+                if (with_values) {
+                  values[e] = local_values[2 * lid + e];
+                }
+              }
+            }
+
+            // Find where the keys of every digit start in the sorted tile.
+            size_t digits[2];
+            for (size_t e = 0; e < 2; e++) {
+              size_t p = 2 * lid + e;
+              digits[e] = static_cast<size_t>((keys[e] >> shift) & mask);
+              if (p < valid &&
+                  (p == 0 ||
+                   static_cast<size_t>((local_keys[p - 1] >> shift) & mask) !=
+                       digits[e])) {
+                digit_start[digits[e]] = static_cast<unsigned int>(p);
+              }
+            }
+            item.barrier(sycl::access::fence_space::local_space);
+
+            for (size_t e = 0; e < 2; e++) {
+              size_t p = 2 * lid + e;
+              if (p < valid) {
+                size_t pos =
+                    digit_offset[digits[e]] + (p - digit_start[digits[e]]);
+                dst_keys[pos] = keys[e];
+                if (with_values) {
+                  dst_values[pos] = values[e];
+                }
+              }
+            }
+            item.barrier(sycl::access::fence_space::local_space);
+
+            // The last key of every digit moves its offset past the tile.
+            for (size_t e = 0; e < 2; e++) {
+              size_t p = 2 * lid + e;
+              if (p < valid &&
+                  (p == valid - 1 ||
+                   static_cast<size_t>((local_keys[p + 1] >> shift) & mask) !=
+                       digits[e])) {
+                digit_offset[digits[e]] += p - digit_start[digits[e]] + 1;
+              }
+            }
+          }
+        });
+  });
+}
+
+/* Sorts the keys in the `keys` buffer in ascending order, and reorders the
+ * values of the `values` buffer in the same way unless `Value` is
+ * `no_values`. See `par_radix_sort`. */
+template <typename Key, typename Value, unsigned Bits>
+void par_radix_sort_impl(sycl::buffer<Key, 1>& keys,
+                         sycl::buffer<Value, 1>& values, sycl::queue& q) {
+  static_assert(std::is_integral<Key>::value && std::is_unsigned<Key>::value,
+                "The keys must be unsigned integers.");
+  static_assert(Bits > 0 && Bits <= 8,
+                "The number of bits per pass must be between 1 and 8.");
+  constexpr bool with_values = !std::is_same<Value, no_values>::value;
+  constexpr unsigned key_bits = sizeof(Key) * 8;
+  constexpr size_t radix = size_t(1) << Bits;
+
+  size_t size = keys.get_count();
+  if (with_values && values.get_count() < size) {
+    throw std::runtime_error("Every key needs a value.");
+  }
+  if (size < 2) {
+    return;
+  }
+
+  /* Every work-item holds two keys and values in local memory, besides the
+   * two elements of the work-group scan, and the work-group holds a start
+   * and an offset for each digit. */
+  size_t pair_size = sizeof(Key) + (with_values ? sizeof(Value) : 0);
+  size_t wgroup_size = scan_wgroup_size<unsigned int, padded_layout<>>(
+      q, size, 2,
+      2 + (2 * pair_size + sizeof(unsigned int) - 1) / sizeof(unsigned int),
+      radix * (sizeof(unsigned int) + sizeof(size_t)) + sizeof(unsigned int));
+  size_t tile_size = 2 * wgroup_size;
+  size_t n_tiles = (size + tile_size - 1) / tile_size;
+
+  /* The histograms have a count per digit and work-group. Every work-group
+   * sorts several tiles, so that they stay small compared to the input. */
+  size_t n_groups =
+      sycl::min(n_tiles, sycl::max(size_t(1), size / (8 * radix)));
+  size_t tiles_per_group = (n_tiles + n_groups - 1) / n_groups;
+  n_groups = (n_tiles + tiles_per_group - 1) / tiles_per_group;
+
+  sycl::buffer<Key, 1> tmp_keys{sycl::range<1>(size)};
+  sycl::buffer<Value, 1> tmp_values{sycl::range<1>(with_values ? size : 1)};
+  sycl::buffer<size_t, 1> hist{sycl::range<1>(radix * n_groups)};
+
+  // Every pass sorts from one pair of buffers into the other.
+  sycl::buffer<Key, 1>* src_keys = &keys;
+  sycl::buffer<Key, 1>* dst_keys = &tmp_keys;
+  sycl::buffer<Value, 1>* src_values = &values;
+  sycl::buffer<Value, 1>* dst_values = &tmp_values;
+  for (unsigned shift = 0; shift < key_bits; shift += Bits) {
+    radix_sort_pass<Key, Value, Bits>(q, size, wgroup_size, n_groups,
+                                      tiles_per_group, shift, *src_keys,
+                                      *dst_keys, *src_values, *dst_values,
+                                      hist);
+    std::swap(src_keys, dst_keys);
+    std::swap(src_values, dst_values);
+  }
+
+  // With an odd number of passes, the result is in the temporary buffers.
+  if (src_keys != &keys) {
+    q.submit([&](sycl::handler& cgh) {
+      auto src_k = tmp_keys.template get_access<sycl::access::mode::read>(cgh);
+      auto dst_k =
+          keys.template get_access<sycl::access::mode::discard_write>(cgh);
+      auto src_v =
+          tmp_values.template get_access<sycl::access::mode::read>(cgh);
+      auto dst_v = values.template get_access<sycl::access::mode::write>(cgh);
+
+      cgh.parallel_for<kernel_name<Key, Value, radix_copy_back<Bits>>>(
+          sycl::range<1>(size), [=](sycl::item<1> item) {
+            size_t i = item.get_linear_id();
+            dst_k[i] = src_k[i];
+            if (with_values) {
+              dst_v[i] = src_v[i];
+            }
+          });
+    });
+  }
+}
+
+/* Sorts the unsigned integer keys of the `keys` buffer in ascending order,
+ * in place, with a least significant digit radix sort. Each pass orders the
+ * keys by their next `Bits` bits with three kernel launches, so a sort takes
+ * `sizeof(Key) * 8 / Bits` passes, rounded up. */
+template <typename Key, unsigned Bits = 4>
+void par_radix_sort(sycl::buffer<Key, 1>& keys, sycl::queue& q) {
+  sycl::buffer<no_values, 1> values{sycl::range<1>(1)};
+  par_radix_sort_impl<Key, no_values, Bits>(keys, values, q);
+}
+
+/* Sorts the unsigned integer keys of the `keys` buffer in ascending order,
+ * moving the elements of the `values` buffer along with their keys. The sort
+ * is stable, so values with equal keys keep their order. See the keys-only
+ * `par_radix_sort`. */
+template <typename Key, typename Value, unsigned Bits = 4>
+void par_radix_sort(sycl::buffer<Key, 1>& keys, sycl::buffer<Value, 1>& values,
+                    sycl::queue& q) {
+  par_radix_sort_impl<Key, Value, Bits>(keys, values, q);
+}
+
+#endif  // INCLUDE_RADIX_SORT_HPP
@@ -29,230 +29,30 @@
 namespace sycl = cl::sycl;
 
 #include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <numeric>
+#include <utility>
 #include <vector>
 
-// The identity element for a given operation.
-template <typename T, typename Op>
-struct identity {};
+#include "radix_sort.hpp"
+#include "scan.hpp"
 
+// Signature of the scan algorithms, to test them all in the same way.
 template <typename T>
-struct identity<T, std::plus<T>> {
-  static constexpr T value = 0;
-};
-
-template <typename T>
-struct identity<T, std::multiplies<T>> {
-  static constexpr T value = 1;
-};
-
-template <typename T>
-struct identity<T, std::logical_or<T>> {
-  static constexpr T value = false;
-};
-
-template <typename T>
-struct identity<T, std::logical_and<T>> {
-  static constexpr T value = true;
-};
-
-// Dummy struct to generate unique kernel name types
-template <typename T, typename U, typename V>
-struct kernel_name {};
-
-/* Performs an inclusive scan with the given associative binary operation `Op`
- * on the data in the `in` buffer. Runs in parallel on the provided accelerated
- * hardware queue. Modifies the input buffer to contain the results of the scan.
- * Input size has to be a power of two. If the size isn't so, the input can
- * easily be padded to the nearest power of two with any values, and the scan on
- * the meaningful part of the data will stay the same. */
-template <typename T, typename Op>
-void par_scan(sycl::buffer<T, 1>& in, sycl::queue& q) {
-  if ((in.get_count() & (in.get_count() - 1)) != 0 || in.get_count() == 0) {
-    throw std::runtime_error("Given input size is not a power of two.");
-  }
-
-  // Retrieve the device associated with the given queue.
-  auto dev = q.get_device();
-
-  // Check if there is enough global memory.
-  size_t global_mem_size = dev.get_info<sycl::info::device::global_mem_size>();
-  if (in.get_count() > (global_mem_size / 2)) {
-    throw std::runtime_error("Input size exceeds device global memory size.");
-  }
-
-  /* Check if local memory is available. On host no local memory is fine, since
-   * it is emulated. */
-  if (!dev.is_host() &&
-      dev.get_info<sycl::info::device::local_mem_type>() ==
-          sycl::info::local_mem_type::none) {
-    throw std::runtime_error("Device does not have local memory.");
-  }
-
-  // Obtain device limits.
-  size_t max_wgroup_size =
-      dev.get_info<sycl::info::device::max_work_group_size>();
-  size_t local_mem_size = dev.get_info<sycl::info::device::local_mem_size>();
-
-  /* Find a work-group size that is guaranteed to fit in local memory and is
-   * below the maximum work-group size of the device. */
-  size_t wgroup_size_lim =
-      sycl::min(max_wgroup_size, local_mem_size / (2 * sizeof(T)));
-
-  /* Every work-item processes two elements, so the work-group size has to
-   * divide this number evenly. */
-  size_t half_in_size = in.get_count() / 2;
-
-  size_t wgroup_size = 0;
-  /* Find the largest power of two that divides half_in_size and is within the
-   * device limit. */
-  for (size_t pow = size_t(1) << (sizeof(size_t) * 8 - 1); pow > 0; pow >>= 1) {
-    if ((half_in_size / pow) * pow == half_in_size && pow <= wgroup_size_lim) {
-      wgroup_size = pow;
-      break;
-    }
-  }
-
-  if (wgroup_size == 0) {
-    throw std::runtime_error(
-        "Could not find an appropriate work-group size for the given input.");
-  }
-
-  q.submit([&](sycl::handler& cgh) {
-    auto data = in.template get_access<sycl::access::mode::read_write>(cgh);
-    sycl::accessor<T, 1, sycl::access::mode::read_write,
-                   sycl::access::target::local>
-
-        temp(wgroup_size * 2, cgh);
-
-    // Use dummy struct as the unique kernel name.
-    cgh.parallel_for<kernel_name<T, Op, class scan_segments>>(
-        sycl::nd_range<1>(half_in_size, wgroup_size),
-        [=](sycl::nd_item<1> item) {
-          /* Two-phase exclusive scan algorithm due to Guy E. Blelloch in
-           * "Prefix Sums and Their Applications", 1990. */
-
-          size_t gid = item.get_global_linear_id();
-          size_t lid = item.get_local_linear_id();
-
-          // Read data into local memory.
-          temp[2 * lid] = data[2 * gid];
-          temp[2 * lid + 1] = data[2 * gid + 1];
-
-          // Preserve the second input element to add at the end.
-          auto second_in = temp[2 * lid + 1];
-
-          /* Perform partial reduction (up-sweep) on the data. The `off`
-           * variable is 2 to the power of the current depth of the
-           * reduction tree. In the paper, this corresponds to 2^d. */
-          for (size_t off = 1; off < (wgroup_size * 2); off *= 2) {
-            // Synchronize local memory to observe the previous writes.
-            item.barrier(sycl::access::fence_space::local_space);
-
-            size_t i = lid * off * 2;
-            if (i < wgroup_size * 2) {
-              temp[i + off * 2 - 1] =
-                  Op{}(temp[i + off * 2 - 1], temp[i + off - 1]);
-            }
-          }
-
-          // Clear the last element to the identity before down-sweeping.
-          if (lid == 0) {
-            temp[wgroup_size * 2 - 1] = identity<T, Op>::value;
-          }
-
-          /* Perform down-sweep on the tree to compute the whole scan.
-           * Again, `off` is 2^d. */
-          for (size_t off = wgroup_size; off > 0; off >>= 1) {
-            item.barrier(sycl::access::fence_space::local_space);
-
-            size_t i = lid * off * 2;
-            if (i < wgroup_size * 2) {
-              auto t = temp[i + off - 1];
-              auto u = temp[i + off * 2 - 1];
-              temp[i + off - 1] = u;
-              temp[i + off * 2 - 1] = Op{}(t, u);
-            }
-          }
-
-          // Synchronize again to observe results.
-          item.barrier(sycl::access::fence_space::local_space);
-
-          /* To return an inclusive rather than exclusive scan result, shift
-           * each element left by 1 when writing back into global memory. If
-           * we are the last work-item, also add on the final element. */
-          data[2 * gid] = temp[2 * lid + 1];
-
-          if (lid == wgroup_size - 1) {
-            data[2 * gid + 1] = Op{}(temp[2 * lid + 1], second_in);
-          } else {
-            data[2 * gid + 1] = temp[2 * lid + 2];
-          }
-        });
-  });
-
-  // At this point we have computed the inclusive scans of this many segments.
-  size_t n_segments = half_in_size / wgroup_size;
-
-  if (n_segments == 1) {
-    // If all of the data is in one segment, we're done.
-    return;
-  }
-  // Otherwise we have to propagate the scan results forward into later
-  // segments.
-
-  // Allocate space for one (last) element per segment.
-  sycl::buffer<T, 1> ends{sycl::range<1>(n_segments)};
-
-  // Store the elements in this space.
-  q.submit([&](sycl::handler& cgh) {
-    auto scans = in.template get_access<sycl::access::mode::read>(cgh);
-    auto elems =
-        ends.template get_access<sycl::access::mode::discard_write>(cgh);
-
-    cgh.parallel_for<kernel_name<T, Op, class copy_ends>>(
-        sycl::range<1>(n_segments), [=](sycl::item<1> item) {
-          auto id = item.get_linear_id();
-          // Offset into the last element of each segment.
-          elems[item] = scans[(id + 1) * 2 * wgroup_size - 1];
-        });
-  });
-
-  // Recursively scan the array of last elements.
-  par_scan<T, Op>(ends, q);
-
-  // Add the results of the scan to each segment.
-  q.submit([&](sycl::handler& cgh) {
-    auto ends_scan = ends.template get_access<sycl::access::mode::read>(cgh);
-    auto data = in.template get_access<sycl::access::mode::read_write>(cgh);
-
-    cgh.parallel_for<kernel_name<T, Op, class add_ends>>(
-        // Work with one less work-group, since the first segment is correct.
-        sycl::nd_range<1>(half_in_size - wgroup_size, wgroup_size),
-        [=](sycl::nd_item<1> item) {
-          auto group = item.get_group_linear_id();
-
-          // Start with the second segment.
-          auto off_gid = item.get_global_linear_id() + wgroup_size;
-
-          /* Each work-group adds the corresponding number in the
-           * "last element scan" array to every element in the group's
-           * segment. */
-          data[off_gid * 2] = Op{}(data[off_gid * 2], ends_scan[group]);
-          data[off_gid * 2 + 1] = Op{}(data[off_gid * 2 + 1], ends_scan[group]);
-        });
-  });
-}
-
-/* Tests the scan with an addition operation, which is its most common use.
- * Returns 0 if successful, a nonzero value otherwise. */
-int test_sum(sycl::queue& q) {
-  constexpr size_t size = 512;
-
-  // Initializes a vector of sequentially increasing values.
+using scan_fn = void (*)(sycl::buffer<T, 1>&, sycl::queue&);
+
+/* Tests the scan with an addition operation, which is its most common use,
+ * on an input of the given size, using the given scan algorithm. Returns 0 if
+ * successful, a nonzero value otherwise. */
+int test_sum(sycl::queue& q, size_t size, scan_fn<int32_t> scan) {
+  /* Initializes a vector of increasing values, wrapping around so that the
+   * sum of large inputs does not overflow. */
   std::vector<int32_t> in(size);
-  std::iota(in.begin(), in.end(), 1);
+  for (size_t i = 0; i < size; i++) {
+    in[i] = static_cast<int32_t>(i % 1000) + 1;
+  }
 
   // Compute the prefix sum using SYCL.
   std::vector<int32_t> sum(in.size());
@@ -261,7 +61,7 @@ int test_sum(sycl::queue& q) {
     sycl::buffer<int32_t, 1> buf(in.data(), sycl::range<1>(in.size()));
     buf.set_final_data(sum.data());
 
-    par_scan<int32_t, std::plus<int32_t>>(buf, q);
+    scan(buf, q);
   }
 
   // Compute the same operation using the standard library.
@@ -271,24 +71,22 @@ int test_sum(sycl::queue& q) {
   // Check if the results are correct.
   auto equal = std::equal(sum.begin(), sum.end(), test_sum.begin());
   if (!equal) {
-    std::cout << "SYCL sum computation incorrect! CPU Results:\n";
-    for (auto a : test_sum) {
-      std::cout << a << " ";
-    }
-    std::cout << "\nSYCL results:\n";
-    for (auto a : sum) {
-      std::cout << a << " ";
-    }
-    std::cout << std::endl;
+    auto mismatch = std::mismatch(sum.begin(), sum.end(), test_sum.begin());
+    std::cout << "SYCL sum computation incorrect for size " << size
+              << "! First difference at index "
+              << (mismatch.first - sum.begin()) << ": CPU result "
+              << *mismatch.second << ", SYCL result " << *mismatch.first
+              << std::endl;
     return 1;
   }
 
   return 0;
 }
 
-/* Tests the scan with a multiply operation, which is a sequence of factorials.
- * Returns 0 if successful, a nonzero value otherwise. */
-int test_factorial(sycl::queue& q) {
+/* Tests the scan with a multiply operation, which is a sequence of factorials,
+ * using the given scan algorithm. Returns 0 if successful, a nonzero value
+ * otherwise. */
+int test_factorial(sycl::queue& q, scan_fn<int64_t> scan) {
   // Anything above this size overflows the int64_t type
   constexpr size_t size = 16;
 
@@ -303,7 +101,7 @@ int test_factorial(sycl::queue& q) {
     sycl::buffer<int64_t, 1> buf(in.data(), sycl::range<1>(in.size()));
     buf.set_final_data(fact.data());
 
-    par_scan<int64_t, std::multiplies<int64_t>>(buf, q);
+    scan(buf, q);
   }
 
   // Compute the same operation using the standard library.
@@ -329,17 +127,412 @@ int test_factorial(sycl::queue& q) {
   return 0;
 }
 
+/* Tests the exclusive scan with an addition operation on an input of the
+ * given size, with the given strategy. Returns 0 if successful, a nonzero
+ * value otherwise. */
+template <typename Strategy>
+int test_exclusive_sum(sycl::queue& q, size_t size) {
+  std::vector<int32_t> in(size);
+  for (size_t i = 0; i < size; i++) {
+    in[i] = static_cast<int32_t>(i % 1000) + 1;
+  }
+
+  std::vector<int32_t> sum(in.size());
+  {
+    sycl::buffer<int32_t, 1> buf(in.data(), sycl::range<1>(in.size()));
+    buf.set_final_data(sum.data());
+
+    par_exclusive_scan<int32_t, std::plus<int32_t>, Strategy>(buf, q);
+  }
+
+  // The exclusive sum of an element is the inclusive sum of the previous one.
+  std::vector<int32_t> test_sum(in.size());
+  if (size > 0) {
+    test_sum[0] = 0;
+    std::partial_sum(in.begin(), in.end() - 1, test_sum.begin() + 1);
+  }
+
+  auto mismatch = std::mismatch(sum.begin(), sum.end(), test_sum.begin());
+  if (mismatch.first != sum.end()) {
+    std::cout << "SYCL exclusive sum computation incorrect for size " << size
+              << "! First difference at index "
+              << (mismatch.first - sum.begin()) << ": CPU result "
+              << *mismatch.second << ", SYCL result " << *mismatch.first
+              << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
+
+/* Tests the segmented scan with an addition operation on an input of the
+ * given size, with both short segments and segments spanning several
+ * work-groups, with both strategies. Since the segmented operation is not
+ * commutative, the same
+ * scan is also performed with `par_scan` and `par_scan_blocked` on the
+ * values paired with their flags, to check the order of their operands.
+ * Returns 0 if successful, a nonzero value otherwise. */
+int test_segmented_sum(sycl::queue& q, size_t size) {
+  using pair_t = segmented_value<int32_t>;
+  using pair_op = segmented_op<int32_t, std::plus<int32_t>>;
+
+  std::vector<int32_t> in(size);
+  std::vector<uint8_t> heads(size);
+  std::vector<pair_t> pairs(size);
+  for (size_t i = 0; i < size; i++) {
+    in[i] = static_cast<int32_t>(i % 1000) + 1;
+    heads[i] = (i % 1000 == 7) || (i < 64 && i % 5 == 0);
+    pairs[i] = {in[i], heads[i]};
+  }
+
+  // Compute the segmented sum sequentially.
+  std::vector<int32_t> test_sum(in.size());
+  for (size_t i = 0; i < size; i++) {
+    test_sum[i] = (i == 0 || heads[i]) ? in[i] : test_sum[i - 1] + in[i];
+  }
+
+  std::vector<std::vector<int32_t>> sums(4, std::vector<int32_t>(size));
+  {
+    sycl::buffer<uint8_t, 1> heads_buf(heads.data(),
+                                       sycl::range<1>(heads.size()));
+    sycl::buffer<int32_t, 1> buf(in.data(), sycl::range<1>(in.size()));
+    buf.set_final_data(sums[0].data());
+    par_segmented_scan<int32_t, std::plus<int32_t>>(buf, heads_buf, q);
+
+    sycl::buffer<int32_t, 1> single_buf(in.data(), sycl::range<1>(in.size()));
+    single_buf.set_final_data(sums[1].data());
+    par_segmented_scan<int32_t, std::plus<int32_t>, single_pass_strategy>(
+        single_buf, heads_buf, q);
+  }
+  for (size_t variant = 2; variant < sums.size(); variant++) {
+    std::vector<pair_t> pair_sums(size);
+    {
+      sycl::buffer<pair_t, 1> buf(pairs.data(), sycl::range<1>(pairs.size()));
+      buf.set_final_data(pair_sums.data());
+
+      if (variant == 2) {
+        par_scan<pair_t, pair_op>(buf, q);
+      } else {
+        par_scan_blocked<pair_t, pair_op>(buf, q);
+      }
+    }
+    for (size_t i = 0; i < size; i++) {
+      sums[variant][i] = pair_sums[i].value;
+    }
+  }
+
+  for (const auto& sum : sums) {
+    auto mismatch = std::mismatch(sum.begin(), sum.end(), test_sum.begin());
+    if (mismatch.first != sum.end()) {
+      std::cout << "SYCL segmented sum computation incorrect for size "
+                << size << "! First difference at index "
+                << (mismatch.first - sum.begin()) << ": CPU result "
+                << *mismatch.second << ", SYCL result " << *mismatch.first
+                << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/* Tests the out-of-place scan with an addition operation, reusing the same
+ * workspace for inputs of several sizes up to its capacity. Returns 0 if
+ * successful, a nonzero value otherwise. */
+int test_out_of_place_sum(sycl::queue& q) {
+  constexpr size_t capacity = 1000003;
+  scan_workspace<int32_t> ws(q, capacity);
+
+  for (size_t size : {capacity, size_t(1000), size_t(3), size_t(1),
+                      size_t(512), capacity}) {
+    std::vector<int32_t> in(size);
+    for (size_t i = 0; i < size; i++) {
+      in[i] = static_cast<int32_t>(i % 1000) + 1;
+    }
+
+    std::vector<int32_t> sum(in.size());
+    std::vector<int32_t> in_after(in.size());
+    {
+      sycl::buffer<int32_t, 1> in_buf(in.data(), sycl::range<1>(in.size()));
+      sycl::buffer<int32_t, 1> out_buf(sum.data(), sycl::range<1>(sum.size()));
+      in_buf.set_final_data(in_after.data());
+
+      par_scan<int32_t, std::plus<int32_t>>(in_buf, out_buf, ws, q);
+    }
+
+    std::vector<int32_t> test_sum(in.size());
+    std::partial_sum(in.begin(), in.end(), test_sum.begin());
+
+    auto mismatch = std::mismatch(sum.begin(), sum.end(), test_sum.begin());
+    if (mismatch.first != sum.end()) {
+      std::cout << "SYCL out-of-place sum computation incorrect for size "
+                << size << "! First difference at index "
+                << (mismatch.first - sum.begin()) << ": CPU result "
+                << *mismatch.second << ", SYCL result " << *mismatch.first
+                << std::endl;
+      return 1;
+    }
+    if (in_after != in) {
+      std::cout << "SYCL out-of-place sum modified its input for size "
+                << size << "!" << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/* Tests the batched scan with an addition operation, on the rows of a matrix
+ * and on the same rows given by their offsets. Rows shorter and longer than
+ * a work-group are scanned together, with the given strategy. Returns 0 if
+ * successful, a nonzero value otherwise. */
+template <typename Strategy>
+int test_rows_sum(sycl::queue& q, size_t rows, size_t cols) {
+  size_t size = rows * cols;
+  std::vector<int32_t> in(size);
+  for (size_t i = 0; i < size; i++) {
+    in[i] = static_cast<int32_t>(i % 1000) + 1;
+  }
+
+  std::vector<int32_t> test_sum(size);
+  for (size_t r = 0; r < rows; r++) {
+    std::partial_sum(in.begin() + r * cols, in.begin() + (r + 1) * cols,
+                     test_sum.begin() + r * cols);
+  }
+
+  // Compressed rows with the same values, with an empty row every 4 rows.
+  std::vector<uint32_t> offsets;
+  for (size_t r = 0; r < rows; r++) {
+    offsets.push_back(static_cast<uint32_t>(r * cols));
+    if (r % 4 == 0) {
+      offsets.push_back(static_cast<uint32_t>(r * cols));
+    }
+  }
+  offsets.push_back(static_cast<uint32_t>(size));
+
+  std::vector<std::vector<int32_t>> sums(2, std::vector<int32_t>(size));
+  {
+    sycl::buffer<int32_t, 2> matrix(in.data(), sycl::range<2>(rows, cols));
+    matrix.set_final_data(sums[0].data());
+
+    par_scan_rows<int32_t, std::plus<int32_t>, Strategy>(matrix, q);
+  }
+  {
+    sycl::buffer<int32_t, 1> values(in.data(), sycl::range<1>(size));
+    sycl::buffer<uint32_t, 1> offsets_buf(offsets.data(),
+                                          sycl::range<1>(offsets.size()));
+    values.set_final_data(sums[1].data());
+
+    par_scan_rows<int32_t, std::plus<int32_t>, Strategy>(values, offsets_buf,
+                                                         q);
+  }
+
+  for (const auto& sum : sums) {
+    auto mismatch = std::mismatch(sum.begin(), sum.end(), test_sum.begin());
+    if (mismatch.first != sum.end()) {
+      std::cout << "SYCL batched sum computation incorrect for " << rows
+                << " rows of " << cols << " elements! First difference at "
+                << "index " << (mismatch.first - sum.begin())
+                << ": CPU result " << *mismatch.second << ", SYCL result "
+                << *mismatch.first << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+// Predicate of the stream compaction tests.
+struct is_multiple_of_3 {
+  bool operator()(int32_t x) const { return x % 3 == 0; }
+};
+
+/* Tests the stream compaction and partition primitives on an input of the
+ * given size, with the given strategy. Returns 0 if successful, a nonzero
+ * value otherwise. */
+template <typename Strategy>
+int test_compaction(sycl::queue& q, size_t size) {
+  std::vector<int32_t> in(size);
+  for (size_t i = 0; i < size; i++) {
+    in[i] = static_cast<int32_t>((i * 7919) % 1000);
+  }
+  is_multiple_of_3 pred;
+
+  // Compute the same operations using the standard library.
+  std::vector<int32_t> test_copy;
+  std::vector<int32_t> test_remove;
+  std::partition_copy(in.begin(), in.end(), std::back_inserter(test_copy),
+                      std::back_inserter(test_remove), pred);
+  std::vector<int32_t> test_partition(test_copy);
+  test_partition.insert(test_partition.end(), test_remove.begin(),
+                        test_remove.end());
+
+  std::vector<int32_t> copied(size);
+  std::vector<int32_t> removed(size);
+  std::vector<int32_t> partitioned(size);
+  size_t n_copied;
+  size_t n_removed;
+  size_t n_first;
+  {
+    sycl::buffer<int32_t, 1> in_buf(in.data(), sycl::range<1>(size));
+    sycl::buffer<int32_t, 1> copied_buf(copied.data(), sycl::range<1>(size));
+    sycl::buffer<int32_t, 1> removed_buf(removed.data(), sycl::range<1>(size));
+    sycl::buffer<int32_t, 1> partitioned_buf(partitioned.data(),
+                                             sycl::range<1>(size));
+
+    n_copied = par_copy_if<Strategy>(in_buf, copied_buf, pred, q);
+    n_removed = par_remove_if<Strategy>(in_buf, removed_buf, pred, q);
+    n_first = par_partition<Strategy>(in_buf, partitioned_buf, pred, q);
+  }
+  copied.resize(n_copied);
+  removed.resize(n_removed);
+
+  if (copied != test_copy || removed != test_remove ||
+      partitioned != test_partition || n_first != test_copy.size()) {
+    std::cout << "SYCL stream compaction incorrect for size " << size << "!"
+              << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
+
+/* Tests the radix sort of keys alone and of key-value pairs, with `Bits` bits
+ * per pass, on pseudo-random keys of the given size with many duplicates.
+ * Returns 0 if successful, a nonzero value otherwise. */
+template <typename Key, unsigned Bits>
+int test_radix_sort(sycl::queue& q, size_t size) {
+  std::vector<Key> keys(size);
+  std::vector<uint32_t> values(size);
+  uint64_t state = 88172645463325252ull;
+  for (size_t i = 0; i < size; i++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    // Every other key repeats a small set, to check the sort is stable.
+    keys[i] = (i % 2 == 0) ? static_cast<Key>(state) : static_cast<Key>(i % 7);
+    values[i] = static_cast<uint32_t>(i);
+  }
+
+  // Compute the same sorts using the standard library.
+  std::vector<std::pair<Key, uint32_t>> test_pairs(size);
+  for (size_t i = 0; i < size; i++) {
+    test_pairs[i] = std::make_pair(keys[i], values[i]);
+  }
+  std::stable_sort(test_pairs.begin(), test_pairs.end(),
+                   [](const std::pair<Key, uint32_t>& a,
+                      const std::pair<Key, uint32_t>& b) {
+                     return a.first < b.first;
+                   });
+
+  std::vector<Key> sorted(keys);
+  std::vector<Key> pair_keys(keys);
+  {
+    sycl::buffer<Key, 1> keys_buf(sorted.data(), sycl::range<1>(size));
+    sycl::buffer<Key, 1> pair_keys_buf(pair_keys.data(), sycl::range<1>(size));
+    sycl::buffer<uint32_t, 1> values_buf(values.data(), sycl::range<1>(size));
+
+    par_radix_sort<Key, Bits>(keys_buf, q);
+    par_radix_sort<Key, uint32_t, Bits>(pair_keys_buf, values_buf, q);
+  }
+
+  for (size_t i = 0; i < size; i++) {
+    if (sorted[i] != test_pairs[i].first ||
+        pair_keys[i] != test_pairs[i].first ||
+        values[i] != test_pairs[i].second) {
+      std::cout << "SYCL radix sort incorrect for size " << size << " and "
+                << Bits << " bits per pass at position " << i << "!"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
 int main() {
   sycl::queue q{sycl::default_selector{}};
 
-  auto ret = test_sum(q);
-  if (ret != 0) {
-    return ret;
+  scan_fn<int32_t> sum_scans[] = {
+      par_scan<int32_t, std::plus<int32_t>>,
+      par_scan<int32_t, std::plus<int32_t>, unpadded_layout>,
+      par_scan_single_pass<int32_t, std::plus<int32_t>>,
+      par_scan_blocked<int32_t, std::plus<int32_t>>,
+      par_scan_blocked<int32_t, std::plus<int32_t>, 3>};
+  scan_fn<int64_t> factorial_scans[] = {
+      par_scan<int64_t, std::multiplies<int64_t>>,
+      par_scan_single_pass<int64_t, std::multiplies<int64_t>>,
+      par_scan_blocked<int64_t, std::multiplies<int64_t>>};
+
+  for (auto scan : sum_scans) {
+    /* Powers of two fill every work-group, the other sizes leave the last one
+     * partially covered. */
+    for (size_t size : {512, 1, 3, 1000, 1000003}) {
+      auto ret = test_sum(q, size, scan);
+      if (ret != 0) {
+        return ret;
+      }
+    }
   }
-  ret = test_factorial(q);
+  for (auto scan : factorial_scans) {
+    auto ret = test_factorial(q, scan);
+    if (ret != 0) {
+      return ret;
+    }
+  }
+  auto ret = test_out_of_place_sum(q);
   if (ret != 0) {
     return ret;
   }
+  for (size_t size : {512, 1, 3, 1000, 1000003}) {
+    ret = test_compaction<multi_pass_strategy>(q, size);
+    if (ret != 0) {
+      return ret;
+    }
+    ret = test_compaction<single_pass_strategy>(q, size);
+    if (ret != 0) {
+      return ret;
+    }
+  }
+  for (size_t cols : {1, 3, 300, 5000}) {
+    ret = test_rows_sum<multi_pass_strategy>(q, 37, cols);
+    if (ret != 0) {
+      return ret;
+    }
+    ret = test_rows_sum<single_pass_strategy>(q, 37, cols);
+    if (ret != 0) {
+      return ret;
+    }
+  }
+  for (size_t size : {512, 1, 3, 1000, 1000003}) {
+    ret = test_exclusive_sum<multi_pass_strategy>(q, size);
+    if (ret != 0) {
+      return ret;
+    }
+    ret = test_exclusive_sum<single_pass_strategy>(q, size);
+    if (ret != 0) {
+      return ret;
+    }
+    ret = test_segmented_sum(q, size);
+    if (ret != 0) {
+      return ret;
+    }
+  }
+  // Four and eight bits take an even number of passes, five an odd one.
+  for (size_t size : {512, 1, 3, 1000, 100003}) {
+    ret = test_radix_sort<uint32_t, 4>(q, size);
+    if (ret != 0) {
+      return ret;
+    }
+    ret = test_radix_sort<uint32_t, 5>(q, size);
+    if (ret != 0) {
+      return ret;
+    }
+    ret = test_radix_sort<uint64_t, 8>(q, size);
+    if (ret != 0) {
+      return ret;
+    }
+  }
 
   std::cout << "Results are correct." << std::endl;
   return 0;
@@ -0,0 +1,1343 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  scan.hpp
+ *
+ *  Description:
+ *    Parallel inclusive scan algorithms in SYCL.
+ *
+ **************************************************************************/
+
+#ifndef INCLUDE_SCAN_HPP
+#define INCLUDE_SCAN_HPP
+
+#include <CL/sycl.hpp>
+namespace sycl = cl::sycl;
+
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// The identity element for a given operation.
+template <typename T, typename Op>
+struct identity {};
+
+template <typename T>
+struct identity<T, std::plus<T>> {
+  static constexpr T value = 0;
+};
+
+template <typename T>
+struct identity<T, std::multiplies<T>> {
+  static constexpr T value = 1;
+};
+
+template <typename T>
+struct identity<T, std::logical_or<T>> {
+  static constexpr T value = false;
+};
+
+template <typename T>
+struct identity<T, std::logical_and<T>> {
+  static constexpr T value = true;
+};
+
+// Dummy struct to generate unique kernel name types
+template <typename T, typename U, typename V>
+struct kernel_name {};
+
+template <typename T>
+using local_accessor =
+    sycl::accessor<T, 1, sycl::access::mode::read_write,
+                   sycl::access::target::local>;
+
+/* Layout of the elements of the work-group scan in local memory, with every
+ * element stored at the index of its position. */
+struct unpadded_layout {
+  static size_t index(size_t i) { return i; }
+
+  // Number of local memory slots needed to store `n` elements.
+  static size_t size(size_t n) { return n; }
+};
+
+/* Layout of the elements of the work-group scan in local memory, with a pad
+ * slot after every `Banks` elements. The scan tree accesses elements with
+ * power-of-two strides, which on devices with `Banks` local memory banks
+ * would otherwise map many work-items to the same bank at deeper levels.
+ * See Harris et al., "Parallel Prefix Sum (Scan) with CUDA", GPU Gems 3. */
+template <size_t Banks = 32>
+struct padded_layout {
+  static_assert(Banks > 0, "The number of banks must be positive.");
+
+  static size_t index(size_t i) { return i + i / Banks; }
+
+  static size_t size(size_t n) { return n + n / Banks; }
+};
+
+/* Checks that the device associated with the given queue can scan an input
+ * of `in_size` elements, and returns the work-group size to use. Every
+ * work-item processes `elems_per_item` elements and stores
+ * `local_elems_per_item` elements in local memory, two of which are laid out
+ * by `Layout` for the work-group scan, along with `extra_local_mem` bytes per
+ * work-group. The size is a power of two, shrunk for inputs too small to need
+ * a whole work-group. */
+template <typename T, typename Layout>
+size_t scan_wgroup_size(sycl::queue& q, size_t in_size,
+                        size_t elems_per_item = 2,
+                        size_t local_elems_per_item = 2,
+                        size_t extra_local_mem = 0) {
+  // Retrieve the device associated with the given queue.
+  auto dev = q.get_device();
+
+  // Check if there is enough global memory.
+  size_t global_mem_size = dev.get_info<sycl::info::device::global_mem_size>();
+  if (in_size > (global_mem_size / 2)) {
+    throw std::runtime_error("Input size exceeds device global memory size.");
+  }
+
+  /* Check if local memory is available. On host no local memory is fine, since
+   * it is emulated. */
+  if (!dev.is_host() &&
+      dev.get_info<sycl::info::device::local_mem_type>() ==
+          sycl::info::local_mem_type::none) {
+    throw std::runtime_error("Device does not have local memory.");
+  }
+
+  // Obtain device limits.
+  size_t max_wgroup_size =
+      dev.get_info<sycl::info::device::max_work_group_size>();
+  size_t local_mem_size = dev.get_info<sycl::info::device::local_mem_size>();
+
+  /* The scan tree needs a power-of-two work-group size. Find the largest
+   * power of two that is below the maximum work-group size of the device and
+   * is guaranteed to fit in local memory. */
+  size_t wgroup_size = 1;
+  while (wgroup_size * 2 <= max_wgroup_size) {
+    wgroup_size *= 2;
+  }
+  auto local_mem_used = [&](size_t size) {
+    size_t elems =
+        Layout::size(2 * size) + (local_elems_per_item - 2) * size;
+    return elems * sizeof(T) + extra_local_mem;
+  };
+  while (wgroup_size > 0 && local_mem_used(wgroup_size) > local_mem_size) {
+    wgroup_size >>= 1;
+  }
+
+  if (wgroup_size == 0) {
+    throw std::runtime_error(
+        "Could not find an appropriate work-group size for the given input.");
+  }
+
+  /* Small inputs do not need the whole work-group, so shrink it while half of
+   * it still covers the input. */
+  while (wgroup_size > 1 && (wgroup_size / 2) * elems_per_item >= in_size) {
+    wgroup_size >>= 1;
+  }
+  return wgroup_size;
+}
+
+/* Replaces the `2 * wgroup_size` elements in `temp`, laid out by `Layout`, by
+ * their exclusive scan with `Op`. Has to be called by every work-item of the
+ * work-group, and synchronizes local memory before returning. */
+template <typename T, typename Op, typename Layout>
+void work_group_scan(sycl::nd_item<1>& item, const local_accessor<T>& temp,
+                     size_t wgroup_size) {
+  /* Two-phase exclusive scan algorithm due to Guy E. Blelloch in
+   * "Prefix Sums and Their Applications", 1990. */
+  size_t lid = item.get_local_linear_id();
+
+  /* Perform partial reduction (up-sweep) on the data. The `off`
+   * variable is 2 to the power of the current depth of the
+   * reduction tree. In the paper, this corresponds to 2^d. */
+  for (size_t off = 1; off < (wgroup_size * 2); off *= 2) {
+    // Synchronize local memory to observe the previous writes.
+    item.barrier(sycl::access::fence_space::local_space);
+
+    size_t i = lid * off * 2;
+    if (i < wgroup_size * 2) {
+      size_t left = Layout::index(i + off - 1);
+      size_t right = Layout::index(i + off * 2 - 1);
+      temp[right] = Op{}(temp[left], temp[right]);
+    }
+  }
+
+  // Clear the last element to the identity before down-sweeping.
+  if (lid == 0) {
+    temp[Layout::index(wgroup_size * 2 - 1)] = identity<T, Op>::value;
+  }
+
+  /* Perform down-sweep on the tree to compute the whole scan.
+   * Again, `off` is 2^d. */
+  for (size_t off = wgroup_size; off > 0; off >>= 1) {
+    item.barrier(sycl::access::fence_space::local_space);
+
+    size_t i = lid * off * 2;
+    if (i < wgroup_size * 2) {
+      size_t left = Layout::index(i + off - 1);
+      size_t right = Layout::index(i + off * 2 - 1);
+      auto t = temp[left];
+      auto u = temp[right];
+      temp[left] = u;
+      temp[right] = Op{}(u, t);
+    }
+  }
+
+  // Synchronize again to observe results.
+  item.barrier(sycl::access::fence_space::local_space);
+}
+
+// Kernel names of par_scan, for each local memory layout.
+template <typename Layout>
+class scan_segments;
+template <typename Layout>
+class copy_ends;
+template <typename Layout>
+class add_ends;
+
+/* Performs an inclusive scan with the given associative binary operation `Op`
+ * on the data in the `in` buffer. Runs in parallel on the provided accelerated
+ * hardware queue. Modifies the input buffer to contain the results of the scan.
+ * The input can have any size. The last work-group may only be partially
+ * covered by the input, in which case its out-of-range elements are read as
+ * the identity of `Op` and never written back.
+ * `Layout` places the elements of the work-group scan in local memory. */
+template <typename T, typename Op, typename Layout = padded_layout<>>
+void par_scan(sycl::buffer<T, 1>& in, sycl::queue& q) {
+  size_t in_size = in.get_count();
+  if (in_size == 0) {
+    return;
+  }
+
+  size_t wgroup_size = scan_wgroup_size<T, Layout>(q, in_size);
+
+  // Number of segments of `2 * wgroup_size` elements, the last one partial.
+  size_t n_segments = (in_size + 2 * wgroup_size - 1) / (2 * wgroup_size);
+
+  q.submit([&](sycl::handler& cgh) {
+    auto data = in.template get_access<sycl::access::mode::read_write>(cgh);
+    local_accessor<T> temp(Layout::size(wgroup_size * 2), cgh);
+
+    // Use dummy struct as the unique kernel name.
+    cgh.parallel_for<kernel_name<T, Op, scan_segments<Layout>>>(
+        sycl::nd_range<1>(n_segments * wgroup_size, wgroup_size),
+        [=](sycl::nd_item<1> item) {
+          size_t gid = item.get_global_linear_id();
+          size_t lid = item.get_local_linear_id();
+
+          size_t first = Layout::index(2 * lid);
+          size_t second = Layout::index(2 * lid + 1);
+
+          /* Read data into local memory. Elements past the end of the input
+           * are replaced by the identity, which leaves the scan unchanged. */
+          if (2 * gid < in_size) {
+            temp[first] = data[2 * gid];
+          } else {
+            temp[first] = identity<T, Op>::value;
+          }
+          if (2 * gid + 1 < in_size) {
+            temp[second] = data[2 * gid + 1];
+          } else {
+            temp[second] = identity<T, Op>::value;
+          }
+
+          // Preserve the second input element to add at the end.
+          auto second_in = temp[second];
+
+          work_group_scan<T, Op, Layout>(item, temp, wgroup_size);
+
+          /* To return an inclusive rather than exclusive scan result, shift
+           * each element left by 1 when writing back into global memory. If
+           * we are the last work-item, also add on the final element. */
+          if (2 * gid < in_size) {
+            data[2 * gid] = temp[second];
+          }
+
+          if (2 * gid + 1 < in_size) {
+            if (lid == wgroup_size - 1) {
+              data[2 * gid + 1] = Op{}(temp[second], second_in);
+            } else {
+              data[2 * gid + 1] = temp[Layout::index(2 * lid + 2)];
+            }
+          }
+        });
+  });
+
+  // At this point we have computed the inclusive scans of all the segments.
+  if (n_segments == 1) {
+    // If all of the data is in one segment, we're done.
+    return;
+  }
+  // Otherwise we have to propagate the scan results forward into later
+  // segments.
+
+  /* Allocate space for one (last) element per segment. The total of the last
+   * segment is never propagated, so it is not stored. */
+  sycl::buffer<T, 1> ends{sycl::range<1>(n_segments - 1)};
+
+  // Store the elements in this space.
+  q.submit([&](sycl::handler& cgh) {
+    auto scans = in.template get_access<sycl::access::mode::read>(cgh);
+    auto elems =
+        ends.template get_access<sycl::access::mode::discard_write>(cgh);
+
+    cgh.parallel_for<kernel_name<T, Op, copy_ends<Layout>>>(
+        sycl::range<1>(n_segments - 1), [=](sycl::item<1> item) {
+          auto id = item.get_linear_id();
+          // Offset into the last element of each segment.
+          elems[item] = scans[(id + 1) * 2 * wgroup_size - 1];
+        });
+  });
+
+  // Recursively scan the array of last elements.
+  par_scan<T, Op, Layout>(ends, q);
+
+  // Add the results of the scan to each segment.
+  q.submit([&](sycl::handler& cgh) {
+    auto ends_scan = ends.template get_access<sycl::access::mode::read>(cgh);
+    auto data = in.template get_access<sycl::access::mode::read_write>(cgh);
+
+    cgh.parallel_for<kernel_name<T, Op, add_ends<Layout>>>(
+        // Work with one less work-group, since the first segment is correct.
+        sycl::nd_range<1>((n_segments - 1) * wgroup_size, wgroup_size),
+        [=](sycl::nd_item<1> item) {
+          auto group = item.get_group_linear_id();
+
+          // Start with the second segment.
+          auto off_gid = item.get_global_linear_id() + wgroup_size;
+
+          /* Each work-group adds the corresponding number in the
+           * "last element scan" array to every element in the group's
+           * segment, skipping the ones past the end of the input. */
+          if (off_gid * 2 < in_size) {
+            data[off_gid * 2] = Op{}(ends_scan[group], data[off_gid * 2]);
+          }
+          if (off_gid * 2 + 1 < in_size) {
+            data[off_gid * 2 + 1] =
+                Op{}(ends_scan[group], data[off_gid * 2 + 1]);
+          }
+        });
+  });
+}
+
+/* Intermediate buffers of the out-of-place `par_scan`, for inputs of up to
+ * `capacity` elements. Each level of the recursion scans the totals of the
+ * segments of the previous one, and the workspace allocates the buffers of
+ * all the levels at once, so that scanning with it does not allocate any
+ * memory. A workspace can be reused for any number of scans, one at a
+ * time. */
+template <typename T, typename Layout = padded_layout<>>
+class scan_workspace {
+ public:
+  scan_workspace(sycl::queue& q, size_t capacity) : m_capacity(capacity) {
+    size_t size = capacity;
+    while (size > 0) {
+      size_t wgroup_size = scan_wgroup_size<T, Layout>(q, size);
+      size_t n_segments = (size + 2 * wgroup_size - 1) / (2 * wgroup_size);
+
+      /* The kernel of a level always has a buffer for the totals of its
+       * segments, even when there is only one segment and none is stored. */
+      m_wgroup_sizes.push_back(wgroup_size);
+      m_ends.emplace_back(sycl::range<1>(sycl::max(n_segments - 1, size_t(1))));
+      size = n_segments - 1;
+    }
+  }
+
+  // Maximum number of elements of the scanned inputs.
+  size_t capacity() const { return m_capacity; }
+
+  size_t num_levels() const { return m_wgroup_sizes.size(); }
+
+  size_t wgroup_size(size_t level) const { return m_wgroup_sizes[level]; }
+
+  // Totals of the segments of the given level, but the last one.
+  sycl::buffer<T, 1>& ends(size_t level) { return m_ends[level]; }
+
+ private:
+  size_t m_capacity;
+  std::vector<size_t> m_wgroup_sizes;
+  std::vector<sycl::buffer<T, 1>> m_ends;
+};
+
+// Kernel names of the out-of-place par_scan, for each local memory layout.
+template <typename Layout>
+class scan_level_segments;
+template <typename Layout>
+class add_level_ends;
+
+/* Scans the first `size` elements of `in` into `out`, which may be the same
+ * buffer, using the given level of the workspace and the following ones. */
+template <typename T, typename Op, typename Layout>
+void par_scan_level(sycl::buffer<T, 1>& in, sycl::buffer<T, 1>& out,
+                    size_t size, scan_workspace<T, Layout>& ws, size_t level,
+                    sycl::queue& q) {
+  size_t wgroup_size = ws.wgroup_size(level);
+  size_t n_segments = (size + 2 * wgroup_size - 1) / (2 * wgroup_size);
+  sycl::buffer<T, 1>& ends = ws.ends(level);
+
+  /* Unlike the in-place `par_scan`, the last work-item of every segment
+   * stores the total of the segment as soon as it is known, so that copying
+   * the totals does not need a kernel of its own. */
+  q.submit([&](sycl::handler& cgh) {
+    auto src = in.template get_access<sycl::access::mode::read>(cgh);
+    auto dst = out.template get_access<sycl::access::mode::write>(cgh);
+    auto elems = ends.template get_access<sycl::access::mode::write>(cgh);
+    local_accessor<T> temp(Layout::size(wgroup_size * 2), cgh);
+
+    cgh.parallel_for<kernel_name<T, Op, scan_level_segments<Layout>>>(
+        sycl::nd_range<1>(n_segments * wgroup_size, wgroup_size),
+        [=](sycl::nd_item<1> item) {
+          size_t gid = item.get_global_linear_id();
+          size_t lid = item.get_local_linear_id();
+          size_t group = item.get_group_linear_id();
+          size_t first = Layout::index(2 * lid);
+          size_t second = Layout::index(2 * lid + 1);
+
+          if (2 * gid < size) {
+            temp[first] = src[2 * gid];
+          } else {
+            temp[first] = identity<T, Op>::value;
+          }
+          if (2 * gid + 1 < size) {
+            temp[second] = src[2 * gid + 1];
+          } else {
+            temp[second] = identity<T, Op>::value;
+          }
+          T second_in = temp[second];
+
+          work_group_scan<T, Op, Layout>(item, temp, wgroup_size);
+
+          if (2 * gid < size) {
+            dst[2 * gid] = temp[second];
+          }
+
+          if (lid == wgroup_size - 1) {
+            T total = Op{}(temp[second], second_in);
+            if (2 * gid + 1 < size) {
+              dst[2 * gid + 1] = total;
+            }
+            if (group < n_segments - 1) {
+              elems[group] = total;
+            }
+          } else if (2 * gid + 1 < size) {
+            dst[2 * gid + 1] = temp[Layout::index(2 * lid + 2)];
+          }
+        });
+  });
+
+  if (n_segments == 1) {
+    return;
+  }
+
+  par_scan_level<T, Op, Layout>(ends, ends, n_segments - 1, ws, level + 1, q);
+
+  q.submit([&](sycl::handler& cgh) {
+    auto ends_scan = ends.template get_access<sycl::access::mode::read>(cgh);
+    auto data = out.template get_access<sycl::access::mode::read_write>(cgh);
+
+    cgh.parallel_for<kernel_name<T, Op, add_level_ends<Layout>>>(
+        sycl::nd_range<1>((n_segments - 1) * wgroup_size, wgroup_size),
+        [=](sycl::nd_item<1> item) {
+          auto group = item.get_group_linear_id();
+          auto off_gid = item.get_global_linear_id() + wgroup_size;
+
+          if (off_gid * 2 < size) {
+            data[off_gid * 2] = Op{}(ends_scan[group], data[off_gid * 2]);
+          }
+          if (off_gid * 2 + 1 < size) {
+            data[off_gid * 2 + 1] =
+                Op{}(ends_scan[group], data[off_gid * 2 + 1]);
+          }
+        });
+  });
+}
+
+/* Performs an inclusive scan with the given associative binary operation `Op`
+ * of the data in the `in` buffer, and writes the result into the first
+ * elements of the `out` buffer, leaving `in` unchanged. The intermediate
+ * buffers are taken from the given workspace, whose capacity has to be at
+ * least the size of the input. */
+template <typename T, typename Op, typename Layout>
+void par_scan(sycl::buffer<T, 1>& in, sycl::buffer<T, 1>& out,
+              scan_workspace<T, Layout>& ws, sycl::queue& q) {
+  size_t in_size = in.get_count();
+  if (in_size > ws.capacity()) {
+    throw std::runtime_error("Input size exceeds the workspace capacity.");
+  }
+  if (out.get_count() < in_size) {
+    throw std::runtime_error("Output is smaller than the input.");
+  }
+  if (in_size == 0) {
+    return;
+  }
+  par_scan_level<T, Op, Layout>(in, out, in_size, ws, 0, q);
+}
+
+/* Performs the out-of-place inclusive scan of `in` into `out` with a
+ * workspace of its own. Scans that are repeated should keep a workspace
+ * instead, to avoid allocating it every time. */
+template <typename T, typename Op, typename Layout = padded_layout<>>
+void par_scan(sycl::buffer<T, 1>& in, sycl::buffer<T, 1>& out,
+              sycl::queue& q) {
+  scan_workspace<T, Layout> ws(q, in.get_count());
+  par_scan<T, Op>(in, out, ws, q);
+}
+
+/* Value of type `T` published by a tile of the single-pass scan in global
+ * memory, for the following tiles to look back at. Plain global stores of a
+ * work-group need not become visible to the others, and atomics to different
+ * words are not ordered, so the value is split into 16-bit halves, each
+ * published with an atomic store together with a flag telling it is valid.
+ * A reader that finds all the words of a value valid has all of it, in
+ * whichever order they became visible. `T` has to be trivially copyable. */
+template <typename T>
+struct tile_descriptor {
+  // Atomic words per value.
+  static constexpr size_t words = (sizeof(T) + 1) / 2;
+  // Flag of the words that have been published.
+  static constexpr unsigned int valid = 1u << 16;
+
+  // Publishes `value` in the given slot of `desc`.
+  template <typename Acc>
+  static void publish(const Acc& desc, size_t slot, const T& value) {
+    unsigned char bytes[2 * words] = {};
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(&value);
+    for (size_t i = 0; i < sizeof(T); i++) {
+      bytes[i] = src[i];
+    }
+    for (size_t w = 0; w < words; w++) {
+      unsigned int half = bytes[2 * w] | (bytes[2 * w + 1] << 8);
+      desc[slot * words + w].store(valid | half);
+    }
+  }
+
+  // Reads the value published in the given slot of `desc` into `value`.
+  // Returns false, leaving `value` untouched, if any of its words has not
+  // been published yet.
+  template <typename Acc>
+  static bool try_read(const Acc& desc, size_t slot, T& value) {
+    unsigned char bytes[2 * words];
+    for (size_t w = 0; w < words; w++) {
+      unsigned int word = desc[slot * words + w].load();
+      if ((word & valid) == 0) {
+        return false;
+      }
+      bytes[2 * w] = word & 0xff;
+      bytes[2 * w + 1] = (word >> 8) & 0xff;
+    }
+    unsigned char* dst = reinterpret_cast<unsigned char*>(&value);
+    for (size_t i = 0; i < sizeof(T); i++) {
+      dst[i] = bytes[i];
+    }
+    return true;
+  }
+};
+
+template <typename T>
+constexpr size_t tile_descriptor<T>::words;
+template <typename T>
+constexpr unsigned int tile_descriptor<T>::valid;
+
+/* Data of a scan performed in place on a buffer. A data policy gives access
+ * to the elements of a scan in the kernels of `single_pass_scan`: its
+ * `get_access` returns an object with the element `load` and `store`
+ * functions, bound to the given command group. */
+template <typename T>
+class in_place_data {
+ public:
+  explicit in_place_data(sycl::buffer<T, 1>& buf) : m_buf(buf) {}
+
+  size_t size() const { return m_buf.get_count(); }
+
+  struct device_data {
+    sycl::accessor<T, 1, sycl::access::mode::read_write,
+                   sycl::access::target::global_buffer>
+        acc;
+
+    T load(size_t i) const { return acc[i]; }
+
+    void store(size_t i, const T& value) const { acc[i] = value; }
+  };
+
+  device_data get_access(sycl::handler& cgh) {
+    return {m_buf.template get_access<sycl::access::mode::read_write>(cgh)};
+  }
+
+ private:
+  sycl::buffer<T, 1>& m_buf;
+};
+
+// Kernel name of single_pass_scan, for each data policy.
+template <typename Data>
+class scan_single_pass;
+
+/* Performs a scan with `Op` on the elements of type `T` given by the `Data`
+ * policy, in a single kernel launch. The result is inclusive or exclusive
+ * depending on `inclusive`.
+ * Each work-group scans a tile of `2 * wgroup_size` elements in local memory
+ * and obtains the reduction of all the previous tiles with the decoupled
+ * look-back of Merrill and Garland, "Single-pass Parallel Prefix Scan with
+ * Decoupled Look-back", 2016. Every element is read and written only once,
+ * instead of once per level of recursion.
+ *
+ * Tiles are numbered in the order in which the work-groups start rather than
+ * by group id, so a work-group only ever waits for groups that are already
+ * running. The published values only go through atomics, see
+ * `tile_descriptor`, but the scan still requires the device to keep running
+ * the work-groups that have started while another one waits for them, which
+ * neither OpenCL 1.2 nor SYCL 1.2.1 guarantee. Devices that do not may hang,
+ * and should use the multi-pass `par_scan` instead, which is the portable
+ * default. */
+template <typename T, typename Op, typename Data>
+void single_pass_scan(sycl::queue& q, Data data_policy, bool inclusive) {
+  size_t in_size = data_policy.size();
+  if (in_size == 0) {
+    return;
+  }
+
+  using layout = padded_layout<>;
+
+  // The tile number and the prefix of the tile are shared in local memory.
+  size_t wgroup_size = scan_wgroup_size<T, layout>(
+      q, in_size, 2, 2, sizeof(unsigned int) + sizeof(T));
+
+  // Number of tiles of `2 * wgroup_size` elements, the last one partial.
+  size_t n_tiles = (in_size + 2 * wgroup_size - 1) / (2 * wgroup_size);
+  if (n_tiles > std::numeric_limits<unsigned int>::max()) {
+    throw std::runtime_error("Input size exceeds the number of tiles.");
+  }
+
+  /* Descriptors of the reduction of every tile alone and of its inclusive
+   * prefix, i.e. the reduction of all the tiles up to and including it, and
+   * the counter handing out tile numbers, all starting at zero, i.e. with
+   * nothing published. */
+  using descriptor = tile_descriptor<T>;
+  const size_t n_words = n_tiles * descriptor::words;
+  const std::vector<unsigned int> zeros(n_words, 0);
+  sycl::buffer<unsigned int, 1> aggregates(zeros.data(),
+                                           sycl::range<1>(n_words));
+  sycl::buffer<unsigned int, 1> prefixes(zeros.data(),
+                                         sycl::range<1>(n_words));
+  sycl::buffer<unsigned int, 1> tile_counter(zeros.data(), sycl::range<1>(1));
+
+  q.submit([&](sycl::handler& cgh) {
+    auto data = data_policy.get_access(cgh);
+    auto counter = tile_counter.get_access<sycl::access::mode::atomic>(cgh);
+    auto tile_aggregates =
+        aggregates.get_access<sycl::access::mode::atomic>(cgh);
+    auto tile_prefixes = prefixes.get_access<sycl::access::mode::atomic>(cgh);
+    local_accessor<T> temp(layout::size(wgroup_size * 2), cgh);
+    local_accessor<unsigned int> tile_id(1, cgh);
+    local_accessor<T> tile_prefix(1, cgh);
+
+    cgh.parallel_for<kernel_name<T, Op, scan_single_pass<Data>>>(
+        sycl::nd_range<1>(n_tiles * wgroup_size, wgroup_size),
+        [=](sycl::nd_item<1> item) {
+          size_t lid = item.get_local_linear_id();
+
+          if (lid == 0) {
+            tile_id[0] = counter[0].fetch_add(1u);
+          }
+          item.barrier(sycl::access::fence_space::local_space);
+          size_t tile = tile_id[0];
+          size_t gid = tile * wgroup_size + lid;
+          size_t first = layout::index(2 * lid);
+          size_t second = layout::index(2 * lid + 1);
+
+          /* Read the tile into local memory, replacing the elements past the
+           * end of the input by the identity. */
+          if (2 * gid < in_size) {
+            temp[first] = data.load(2 * gid);
+          } else {
+            temp[first] = identity<T, Op>::value;
+          }
+          if (2 * gid + 1 < in_size) {
+            temp[second] = data.load(2 * gid + 1);
+          } else {
+            temp[second] = identity<T, Op>::value;
+          }
+          T second_in = temp[second];
+
+          work_group_scan<T, Op, layout>(item, temp, wgroup_size);
+
+          /* The last work-item holds the reduction of the tile. It publishes
+           * it, then combines the values published by the previous tiles,
+           * walking back until one of them has its inclusive prefix. */
+          if (lid == wgroup_size - 1) {
+            T aggregate = Op{}(temp[second], second_in);
+            if (tile > 0) {
+              descriptor::publish(tile_aggregates, tile, aggregate);
+            }
+
+            T exclusive = identity<T, Op>::value;
+            for (size_t pred = tile; pred-- > 0;) {
+              // Predecessors are visited backwards, so they go on the left.
+              T value;
+              bool is_prefix;
+              do {
+                is_prefix = descriptor::try_read(tile_prefixes, pred, value);
+              } while (!is_prefix &&
+                       !descriptor::try_read(tile_aggregates, pred, value));
+              exclusive = Op{}(value, exclusive);
+              if (is_prefix) {
+                break;
+              }
+            }
+
+            descriptor::publish(tile_prefixes, tile,
+                                Op{}(exclusive, aggregate));
+            tile_prefix[0] = exclusive;
+          }
+          item.barrier(sycl::access::fence_space::local_space);
+          T prefix = tile_prefix[0];
+
+          if (!inclusive) {
+            // The work-group scan is exclusive, just add the previous tiles.
+            if (2 * gid < in_size) {
+              data.store(2 * gid, Op{}(prefix, temp[first]));
+            }
+            if (2 * gid + 1 < in_size) {
+              data.store(2 * gid + 1, Op{}(prefix, temp[second]));
+            }
+            return;
+          }
+
+          // Shift left by 1 as in `par_scan`, adding the previous tiles.
+          if (2 * gid < in_size) {
+            data.store(2 * gid, Op{}(prefix, temp[second]));
+          }
+
+          if (2 * gid + 1 < in_size) {
+            if (lid == wgroup_size - 1) {
+              data.store(2 * gid + 1,
+                         Op{}(prefix, Op{}(temp[second], second_in)));
+            } else {
+              data.store(2 * gid + 1,
+                         Op{}(prefix, temp[layout::index(2 * lid + 2)]));
+            }
+          }
+        });
+  });
+}
+
+// Kernel names of multi_pass_scan, for each data policy.
+template <typename Data>
+class scan_load;
+template <typename Data>
+class scan_store;
+
+/* Performs the same scan as `single_pass_scan`, with the multi-pass
+ * `par_scan`: the elements given by the `Data` policy are loaded into a
+ * buffer of their own, scanned, and stored back. It takes more kernel
+ * launches and memory traffic, but no work-group ever waits for another, so
+ * it runs on any device. */
+template <typename T, typename Op, typename Data>
+void multi_pass_scan(sycl::queue& q, Data data_policy, bool inclusive) {
+  size_t in_size = data_policy.size();
+  if (in_size == 0) {
+    return;
+  }
+
+  sycl::buffer<T, 1> values{sycl::range<1>(in_size)};
+  q.submit([&](sycl::handler& cgh) {
+    auto data = data_policy.get_access(cgh);
+    auto out =
+        values.template get_access<sycl::access::mode::discard_write>(cgh);
+    cgh.parallel_for<kernel_name<T, Op, scan_load<Data>>>(
+        sycl::range<1>(in_size), [=](sycl::item<1> item) {
+          out[item] = data.load(item.get_linear_id());
+        });
+  });
+
+  par_scan<T, Op>(values, q);
+
+  q.submit([&](sycl::handler& cgh) {
+    auto data = data_policy.get_access(cgh);
+    auto scan = values.template get_access<sycl::access::mode::read>(cgh);
+    cgh.parallel_for<kernel_name<T, Op, scan_store<Data>>>(
+        sycl::range<1>(in_size), [=](sycl::item<1> item) {
+          size_t i = item.get_linear_id();
+          if (inclusive) {
+            data.store(i, scan[i]);
+          } else if (i > 0) {
+            data.store(i, scan[i - 1]);
+          } else {
+            T first = identity<T, Op>::value;
+            data.store(i, first);
+          }
+        });
+  });
+}
+
+/* Strategies of the scans of data policies, given as a template argument of
+ * the functions below. The multi-pass strategy is the default, as it works
+ * on every device. The single-pass strategy reads and writes every element
+ * only once, but requires the device to make progress on the work-groups
+ * that have started while another one waits for them, see
+ * `single_pass_scan`. */
+struct multi_pass_strategy {};
+struct single_pass_strategy {};
+
+template <typename T, typename Op, typename Data>
+void scan_data(sycl::queue& q, Data data_policy, bool inclusive,
+               multi_pass_strategy) {
+  multi_pass_scan<T, Op>(q, data_policy, inclusive);
+}
+
+template <typename T, typename Op, typename Data>
+void scan_data(sycl::queue& q, Data data_policy, bool inclusive,
+               single_pass_strategy) {
+  single_pass_scan<T, Op>(q, data_policy, inclusive);
+}
+
+/* Performs the same inclusive scan as `par_scan`, in a single kernel launch.
+ * See `single_pass_scan`: the device has to make progress on the
+ * work-groups that have started while another one waits for them. */
+template <typename T, typename Op>
+void par_scan_single_pass(sycl::buffer<T, 1>& in, sycl::queue& q) {
+  single_pass_scan<T, Op>(q, in_place_data<T>(in), true);
+}
+
+/* Performs an exclusive scan with the given associative binary operation `Op`
+ * on the data in the `in` buffer, in place: every element is replaced by the
+ * result of `Op` on all the elements before it, the first one by the
+ * identity of `Op`. Runs on `par_scan` by default; `single_pass_strategy`
+ * runs it in a single kernel launch instead, on devices that make progress
+ * on the work-groups that have started while another one waits for them. */
+template <typename T, typename Op, typename Strategy = multi_pass_strategy>
+void par_exclusive_scan(sycl::buffer<T, 1>& in, sycl::queue& q) {
+  scan_data<T, Op>(q, in_place_data<T>(in), false, Strategy{});
+}
+
+/* Element of a segmented scan: a value, and whether it is the head of a
+ * segment. */
+template <typename T>
+struct segmented_value {
+  T value;
+  unsigned int head;
+};
+
+/* Turns `Op` into the operation of a segmented scan, which restarts at the
+ * head of every segment. It is associative whenever `Op` is, so a segmented
+ * scan is an ordinary scan with this operation, and segments spanning
+ * several work-groups are handled like any other data.
+ * See Blelloch, "Prefix Sums and Their Applications", 1990, section 1.5. */
+template <typename T, typename Op>
+struct segmented_op {
+  segmented_value<T> operator()(const segmented_value<T>& a,
+                                const segmented_value<T>& b) const {
+    return {b.head ? b.value : Op{}(a.value, b.value), a.head | b.head};
+  }
+};
+
+template <typename T, typename Op>
+struct identity<segmented_value<T>, segmented_op<T, Op>> {
+  static constexpr segmented_value<T> value = {identity<T, Op>::value, 0};
+};
+
+template <typename T, typename Op>
+constexpr segmented_value<T>
+    identity<segmented_value<T>, segmented_op<T, Op>>::value;
+
+/* Data of a segmented scan performed in place on the `values` buffer, with
+ * the non-zero elements of the `heads` buffer marking the segment heads. */
+template <typename T, typename Flag>
+class segmented_data {
+ public:
+  segmented_data(sycl::buffer<T, 1>& values, sycl::buffer<Flag, 1>& heads)
+      : m_values(values), m_heads(heads) {}
+
+  size_t size() const { return m_values.get_count(); }
+
+  struct device_data {
+    sycl::accessor<T, 1, sycl::access::mode::read_write,
+                   sycl::access::target::global_buffer>
+        values;
+    sycl::accessor<Flag, 1, sycl::access::mode::read,
+                   sycl::access::target::global_buffer>
+        heads;
+
+    segmented_value<T> load(size_t i) const {
+      return {values[i], heads[i] != Flag(0) ? 1u : 0u};
+    }
+
+    void store(size_t i, const segmented_value<T>& value) const {
+      values[i] = value.value;
+    }
+  };
+
+  device_data get_access(sycl::handler& cgh) {
+    return {m_values.template get_access<sycl::access::mode::read_write>(cgh),
+            m_heads.template get_access<sycl::access::mode::read>(cgh)};
+  }
+
+ private:
+  sycl::buffer<T, 1>& m_values;
+  sycl::buffer<Flag, 1>& m_heads;
+};
+
+/* Performs an inclusive segmented scan with the given associative binary
+ * operation `Op` on the data in the `in` buffer, in place. The scan restarts
+ * at every element whose flag in `heads` is non-zero; the first element
+ * always starts a segment. The number of kernel launches does not depend on
+ * the length of the segments. Runs on `par_scan` by default;
+ * `single_pass_strategy` runs it in a single kernel launch instead, on
+ * devices that make progress on the work-groups that have started while
+ * another one waits for them. */
+template <typename T, typename Op, typename Strategy = multi_pass_strategy,
+          typename Flag>
+void par_segmented_scan(sycl::buffer<T, 1>& in, sycl::buffer<Flag, 1>& heads,
+                        sycl::queue& q) {
+  if (heads.get_count() < in.get_count()) {
+    throw std::runtime_error("Every element needs a segment head flag.");
+  }
+  scan_data<segmented_value<T>, segmented_op<T, Op>>(
+      q, segmented_data<T, Flag>(in, heads), true, Strategy{});
+}
+
+/* Data of a batched scan performed in place on every row of a matrix. Each
+ * row is a segment of the flattened matrix, whose heads are found from the
+ * number of columns. */
+template <typename T>
+class rows_data {
+ public:
+  explicit rows_data(sycl::buffer<T, 2>& matrix) : m_matrix(matrix) {}
+
+  size_t size() const { return m_matrix.get_range().size(); }
+
+  struct device_data {
+    sycl::accessor<T, 2, sycl::access::mode::read_write,
+                   sycl::access::target::global_buffer>
+        acc;
+    size_t cols;
+
+    segmented_value<T> load(size_t i) const {
+      return {acc[sycl::id<2>(i / cols, i % cols)], i % cols == 0 ? 1u : 0u};
+    }
+
+    void store(size_t i, const segmented_value<T>& value) const {
+      acc[sycl::id<2>(i / cols, i % cols)] = value.value;
+    }
+  };
+
+  device_data get_access(sycl::handler& cgh) {
+    return {m_matrix.template get_access<sycl::access::mode::read_write>(cgh),
+            m_matrix.get_range()[1]};
+  }
+
+ private:
+  sycl::buffer<T, 2>& m_matrix;
+};
+
+/* Data of a batched scan performed in place on rows of variable length,
+ * stored one after the other in `values`, with the sorted `offsets` giving
+ * the index of the first element of every row. An element starts a row if a
+ * binary search finds its index among the offsets. */
+template <typename T, typename Index>
+class offsets_data {
+ public:
+  offsets_data(sycl::buffer<T, 1>& values, sycl::buffer<Index, 1>& offsets)
+      : m_values(values), m_offsets(offsets) {}
+
+  size_t size() const { return m_values.get_count(); }
+
+  struct device_data {
+    sycl::accessor<T, 1, sycl::access::mode::read_write,
+                   sycl::access::target::global_buffer>
+        values;
+    sycl::accessor<Index, 1, sycl::access::mode::read,
+                   sycl::access::target::global_buffer>
+        offsets;
+    size_t n_offsets;
+
+    unsigned int is_head(size_t i) const {
+      size_t lo = 0;
+      size_t hi = n_offsets;
+      while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (static_cast<size_t>(offsets[mid]) < i) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      return lo < n_offsets && static_cast<size_t>(offsets[lo]) == i;
+    }
+
+    segmented_value<T> load(size_t i) const { return {values[i], is_head(i)}; }
+
+    void store(size_t i, const segmented_value<T>& value) const {
+      values[i] = value.value;
+    }
+  };
+
+  device_data get_access(sycl::handler& cgh) {
+    return {m_values.template get_access<sycl::access::mode::read_write>(cgh),
+            m_offsets.template get_access<sycl::access::mode::read>(cgh),
+            m_offsets.get_count()};
+  }
+
+ private:
+  sycl::buffer<T, 1>& m_values;
+  sycl::buffer<Index, 1>& m_offsets;
+};
+
+/* Performs an inclusive scan with the given associative binary operation `Op`
+ * of every row of the `matrix` buffer independently, in place. The rows are
+ * the segments of a segmented scan of the whole matrix, so short rows share
+ * a work-group and long rows are spread over as many work-groups as their
+ * length requires. Runs on `par_scan` by default; `single_pass_strategy`
+ * runs it in a single kernel launch instead, on devices that make progress
+ * on the work-groups that have started while another one waits for them. */
+template <typename T, typename Op, typename Strategy = multi_pass_strategy>
+void par_scan_rows(sycl::buffer<T, 2>& matrix, sycl::queue& q) {
+  scan_data<segmented_value<T>, segmented_op<T, Op>>(
+      q, rows_data<T>(matrix), true, Strategy{});
+}
+
+/* Performs an inclusive scan with the given associative binary operation `Op`
+ * of every row of `values` independently, in place. `offsets` holds the
+ * sorted indices of the first element of every row. A final entry equal to
+ * the number of values, as in the compressed sparse row format, is accepted
+ * and ignored. Elements before the first offset form a row of their own.
+ * The strategies are the same as for the rows of a matrix. */
+template <typename T, typename Op, typename Strategy = multi_pass_strategy,
+          typename Index>
+void par_scan_rows(sycl::buffer<T, 1>& values, sycl::buffer<Index, 1>& offsets,
+                   sycl::queue& q) {
+  scan_data<segmented_value<T>, segmented_op<T, Op>>(
+      q, offsets_data<T, Index>(values, offsets), true, Strategy{});
+}
+
+/* Data of a stream compaction of `in` into `out`. The scanned elements are
+ * the flags telling whether `pred` is `keep` for each input element, which
+ * are computed when loading them rather than stored in a buffer of their
+ * own. Storing the exclusive scan of an element scatters it to its position
+ * in `out` if it is kept, evaluating the predicate again.
+ * The number of kept elements is written to `counts[0]` if `keep` is true,
+ * or else to `counts[1]`. If `after_kept` is true, the positions start after
+ * the `counts[0]` elements kept by a previous compaction. */
+template <typename T, typename Pred>
+class select_data {
+ public:
+  select_data(sycl::buffer<T, 1>& in, sycl::buffer<T, 1>& out, Pred pred,
+              sycl::buffer<size_t, 1>& counts, bool keep, bool after_kept)
+      : m_in(in),
+        m_out(out),
+        m_pred(pred),
+        m_counts(counts),
+        m_keep(keep),
+        m_after_kept(after_kept) {}
+
+  size_t size() const { return m_in.get_count(); }
+
+  struct device_data {
+    sycl::accessor<T, 1, sycl::access::mode::read,
+                   sycl::access::target::global_buffer>
+        in;
+    sycl::accessor<T, 1, sycl::access::mode::write,
+                   sycl::access::target::global_buffer>
+        out;
+    sycl::accessor<size_t, 1, sycl::access::mode::read_write,
+                   sycl::access::target::global_buffer>
+        counts;
+    Pred pred;
+    bool keep;
+    bool after_kept;
+    size_t size;
+
+    size_t load(size_t i) const { return pred(in[i]) == keep ? 1 : 0; }
+
+    void store(size_t i, size_t position) const {
+      T value = in[i];
+      size_t selected = pred(value) == keep ? 1 : 0;
+      if (selected) {
+        size_t offset = after_kept ? counts[0] : 0;
+        out[offset + position] = value;
+      }
+      if (i == size - 1) {
+        counts[keep ? 0 : 1] = position + selected;
+      }
+    }
+  };
+
+  device_data get_access(sycl::handler& cgh) {
+    return {m_in.template get_access<sycl::access::mode::read>(cgh),
+            m_out.template get_access<sycl::access::mode::write>(cgh),
+            m_counts.template get_access<sycl::access::mode::read_write>(cgh),
+            m_pred,
+            m_keep,
+            m_after_kept,
+            m_in.get_count()};
+  }
+
+ private:
+  sycl::buffer<T, 1>& m_in;
+  sycl::buffer<T, 1>& m_out;
+  Pred m_pred;
+  sycl::buffer<size_t, 1>& m_counts;
+  bool m_keep;
+  bool m_after_kept;
+};
+
+/* Copies the elements of `in` for which `keep` is the result of `pred`
+ * into `out`, which must be large enough for them, and writes their number
+ * into `counts` as described for `select_data`. The positions are given by
+ * an exclusive scan of the flags with the given strategy, see
+ * `par_exclusive_scan`. */
+template <typename Strategy = multi_pass_strategy, typename T, typename Pred>
+void par_select(sycl::buffer<T, 1>& in, sycl::buffer<T, 1>& out, Pred pred,
+                sycl::buffer<size_t, 1>& counts, bool keep, bool after_kept,
+                sycl::queue& q) {
+  if (out.get_count() < in.get_count()) {
+    throw std::runtime_error("Output is smaller than the input.");
+  }
+  if (in.get_count() == 0) {
+    return;
+  }
+  scan_data<size_t, std::plus<size_t>>(
+      q, select_data<T, Pred>(in, out, pred, counts, keep, after_kept), false,
+      Strategy{});
+}
+
+/* Copies the elements of `in` that satisfy `pred` into the first elements of
+ * `out`, keeping their order, and returns their number. The predicate is
+ * evaluated while loading the input of an exclusive scan, which gives the
+ * position of every copied element. The scan runs on `par_scan` by default;
+ * with `single_pass_strategy` it runs in a single kernel launch and needs no
+ * buffer of flags, on devices that make progress on the work-groups that
+ * have started while another one waits for them. `Pred` is part of the
+ * kernel name, so it has to be a type declared at namespace scope, such as a
+ * function object. */
+template <typename Strategy = multi_pass_strategy, typename T, typename Pred>
+size_t par_copy_if(sycl::buffer<T, 1>& in, sycl::buffer<T, 1>& out, Pred pred,
+                   sycl::queue& q) {
+  const std::vector<size_t> zeros(2, 0);
+  sycl::buffer<size_t, 1> counts(zeros.data(), sycl::range<1>(2));
+  par_select<Strategy>(in, out, pred, counts, true, false, q);
+  return counts.get_access<sycl::access::mode::read>()[0];
+}
+
+/* Copies the elements of `in` that do not satisfy `pred` into the first
+ * elements of `out`, keeping their order, and returns their number, as
+ * `std::remove_copy_if` does. See `par_copy_if`, also for the strategies and
+ * their device requirements. */
+template <typename Strategy = multi_pass_strategy, typename T, typename Pred>
+size_t par_remove_if(sycl::buffer<T, 1>& in, sycl::buffer<T, 1>& out,
+                     Pred pred, sycl::queue& q) {
+  const std::vector<size_t> zeros(2, 0);
+  sycl::buffer<size_t, 1> counts(zeros.data(), sycl::range<1>(2));
+  par_select<Strategy>(in, out, pred, counts, false, false, q);
+  return counts.get_access<sycl::access::mode::read>()[1];
+}
+
+/* Copies all the elements of `in` into `out`, the ones that satisfy `pred`
+ * first, keeping the relative order of the elements in both groups, and
+ * returns the number of elements that satisfy `pred`.
+ * The elements that satisfy `pred` are copied as by `par_copy_if`, then the
+ * others as by `par_remove_if`, with their positions offset on the device by
+ * the number of the former, so no transfer to the host is needed in
+ * between. The strategies and their device requirements are the same as for
+ * `par_copy_if`. */
+template <typename Strategy = multi_pass_strategy, typename T, typename Pred>
+size_t par_partition(sycl::buffer<T, 1>& in, sycl::buffer<T, 1>& out,
+                     Pred pred, sycl::queue& q) {
+  const std::vector<size_t> zeros(2, 0);
+  sycl::buffer<size_t, 1> counts(zeros.data(), sycl::range<1>(2));
+  par_select<Strategy>(in, out, pred, counts, true, false, q);
+  par_select<Strategy>(in, out, pred, counts, false, true, q);
+  return counts.get_access<sycl::access::mode::read>()[0];
+}
+
+// Kernel names of par_scan_blocked, for each number of elements per item.
+template <size_t K>
+class scan_blocked_segments;
+template <size_t K>
+class copy_blocked_ends;
+template <size_t K>
+class add_blocked_ends;
+
+/* Performs the same inclusive scan as `par_scan`, with every work-item
+ * processing `K` consecutive elements instead of two. A work-item scans its
+ * elements serially in private memory, and the work-group scan in local
+ * memory only runs over the totals of the work-items. Each work-group then
+ * covers `K * wgroup_size` elements, so larger blocks need fewer work-groups
+ * and fewer levels of recursion.
+ * The tile of the work-group is staged in local memory, so that global memory
+ * is read and written by consecutive work-items. */
+template <typename T, typename Op, size_t K>
+void par_scan_blocked(sycl::buffer<T, 1>& in, sycl::queue& q) {
+  static_assert(K > 0, "Every work-item has to process some elements.");
+  size_t in_size = in.get_count();
+  if (in_size == 0) {
+    return;
+  }
+
+  using layout = padded_layout<>;
+
+  // The tile and the totals of the work-items are kept in local memory.
+  size_t wgroup_size = scan_wgroup_size<T, layout>(q, in_size, K, K + 1);
+  size_t tile_size = K * wgroup_size;
+
+  /* The totals are scanned by `work_group_scan`, which handles two elements
+   * per work-item, so only half of the work-items take part. A work-group of
+   * one work-item pads its total with the identity. */
+  size_t tree_size = sycl::max(wgroup_size / 2, size_t(1));
+
+  // Number of tiles, the last one partial.
+  size_t n_segments = (in_size + tile_size - 1) / tile_size;
+
+  q.submit([&](sycl::handler& cgh) {
+    auto data = in.template get_access<sycl::access::mode::read_write>(cgh);
+    local_accessor<T> tile(tile_size, cgh);
+    local_accessor<T> temp(layout::size(tree_size * 2), cgh);
+
+    cgh.parallel_for<kernel_name<T, Op, scan_blocked_segments<K>>>(
+        sycl::nd_range<1>(n_segments * wgroup_size, wgroup_size),
+        [=](sycl::nd_item<1> item) {
+          size_t lid = item.get_local_linear_id();
+          size_t base = item.get_group_linear_id() * tile_size;
+
+          /* Read the tile into local memory, replacing the elements past the
+           * end of the input by the identity. */
+          for (size_t k = 0; k < K; k++) {
+            size_t i = k * wgroup_size + lid;
+            if (base + i < in_size) {
+              tile[i] = data[base + i];
+            } else {
+              tile[i] = identity<T, Op>::value;
+            }
+          }
+          item.barrier(sycl::access::fence_space::local_space);
+
+          // Serial inclusive scan of the elements of this work-item.
+          T vals[K];
+          vals[0] = tile[lid * K];
+          for (size_t k = 1; k < K; k++) {
+            vals[k] = Op{}(vals[k - 1], tile[lid * K + k]);
+          }
+
+          temp[layout::index(lid)] = vals[K - 1];
+          if (lid + wgroup_size < tree_size * 2) {
+            temp[layout::index(lid + wgroup_size)] = identity<T, Op>::value;
+          }
+          work_group_scan<T, Op, layout>(item, temp, tree_size);
+
+          // Add the totals of the previous work-items to every element.
+          T prefix = temp[layout::index(lid)];
+          for (size_t k = 0; k < K; k++) {
+            tile[lid * K + k] = Op{}(prefix, vals[k]);
+          }
+          item.barrier(sycl::access::fence_space::local_space);
+
+          for (size_t k = 0; k < K; k++) {
+            size_t i = k * wgroup_size + lid;
+            if (base + i < in_size) {
+              data[base + i] = tile[i];
+            }
+          }
+        });
+  });
+
+  if (n_segments == 1) {
+    return;
+  }
+
+  // Propagate the totals of the tiles as in `par_scan`.
+  sycl::buffer<T, 1> ends{sycl::range<1>(n_segments - 1)};
+
+  q.submit([&](sycl::handler& cgh) {
+    auto scans = in.template get_access<sycl::access::mode::read>(cgh);
+    auto elems =
+        ends.template get_access<sycl::access::mode::discard_write>(cgh);
+
+    cgh.parallel_for<kernel_name<T, Op, copy_blocked_ends<K>>>(
+        sycl::range<1>(n_segments - 1), [=](sycl::item<1> item) {
+          auto id = item.get_linear_id();
+          elems[item] = scans[(id + 1) * tile_size - 1];
+        });
+  });
+
+  par_scan_blocked<T, Op, K>(ends, q);
+
+  q.submit([&](sycl::handler& cgh) {
+    auto ends_scan = ends.template get_access<sycl::access::mode::read>(cgh);
+    auto data = in.template get_access<sycl::access::mode::read_write>(cgh);
+
+    cgh.parallel_for<kernel_name<T, Op, add_blocked_ends<K>>>(
+        sycl::nd_range<1>((n_segments - 1) * wgroup_size, wgroup_size),
+        [=](sycl::nd_item<1> item) {
+          auto group = item.get_group_linear_id();
+          size_t base = (group + 1) * tile_size + item.get_local_linear_id();
+
+          for (size_t k = 0; k < K; k++) {
+            size_t i = base + k * wgroup_size;
+            if (i < in_size) {
+              data[i] = Op{}(ends_scan[group], data[i]);
+            }
+          }
+        });
+  });
+}
+
+/* Returns the number of elements per work-item that `par_scan_blocked` uses
+ * on the device associated with the given queue: the largest of 16, 8, 4 and
+ * 2 for which a work-group of the maximum size fits in local memory. Beyond
+ * that, larger blocks would only be obtained by shrinking the work-groups. */
+template <typename T>
+size_t scan_block_size(sycl::queue& q) {
+  auto dev = q.get_device();
+  size_t max_wgroup_size =
+      dev.get_info<sycl::info::device::max_work_group_size>();
+  size_t local_mem_size = dev.get_info<sycl::info::device::local_mem_size>();
+
+  // Local memory used as computed by `scan_wgroup_size`.
+  for (size_t k = 16; k > 2; k /= 2) {
+    size_t elems = padded_layout<>::size(2 * max_wgroup_size) +
+                   (k - 1) * max_wgroup_size;
+    if (elems * sizeof(T) <= local_mem_size) {
+      return k;
+    }
+  }
+  return 2;
+}
+
+/* Performs `par_scan_blocked` with the number of elements per work-item
+ * given by `scan_block_size`. */
+template <typename T, typename Op>
+void par_scan_blocked(sycl::buffer<T, 1>& in, sycl::queue& q) {
+  switch (scan_block_size<T>(q)) {
+    case 16:
+      par_scan_blocked<T, Op, 16>(in, q);
+      break;
+    case 8:
+      par_scan_blocked<T, Op, 8>(in, q);
+      break;
+    case 4:
+      par_scan_blocked<T, Op, 4>(in, q);
+      break;
+    default:
+      par_scan_blocked<T, Op, 2>(in, q);
+      break;
+  }
+}
+
+#endif  // INCLUDE_SCAN_HPP
@@ -0,0 +1,351 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  arena_allocator.hpp
+ *
+ *  Description:
+ *    Bump allocator over a chain of memory chunks, with mark/rewind
+ *    checkpoints, that can be used as the allocator of SYCL buffers.
+ *
+ **************************************************************************/
+
+#ifndef INCLUDE_ARENA_ALLOCATOR_HPP
+#define INCLUDE_ARENA_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/**
+ * arena
+ *  Hands out memory by bumping a pointer through a chain of chunks.
+ *  Individual allocations are never released: the memory is reclaimed in
+ *  bulk by rewinding the arena to a marker obtained earlier, or by
+ *  resetting it. Chunks are kept after a rewind and reused by later
+ *  allocations, so a steady state performs no system allocation at all.
+ *  An arena is not thread-safe.
+ */
+class arena
+{
+  public:
+
+  /* Position in the arena, obtained with mark() and passed to rewind()
+   */
+  struct marker
+  {
+    std::size_t m_chunk;
+    std::size_t m_offset;
+  };
+
+  /**
+   * Creates an empty arena. No memory is allocated until the first
+   * allocation.
+   * \param chunkSize Size in bytes of each chunk. Larger requests get a
+   *        chunk of their own.
+   */
+  explicit arena(std::size_t chunkSize = 1 << 20)
+    : m_chunkSize{chunkSize}, m_chunks{}, m_current{0}, m_offset{0}
+  { }
+
+  arena(const arena&) = delete;
+  arena& operator=(const arena&) = delete;
+
+  /**
+   * Returns a block of the given size, aligned to the given alignment.
+   * \param alignment Power of two
+   * \throws std::bad_alloc if a new chunk cannot be allocated
+   */
+  void* allocate(std::size_t bytes, std::size_t alignment)
+  {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+      throw std::invalid_argument("The alignment must be a power of two");
+    }
+    // Worst case padding needed to align the start of the block
+    if (bytes > std::numeric_limits<std::size_t>::max() - (alignment - 1))
+    {
+      throw std::bad_alloc();
+    }
+    // Try the current chunk, then the chunks kept after a rewind
+    for (; m_current < m_chunks.size(); m_current++, m_offset = 0)
+    {
+      void* ptr = bump(m_chunks[m_current], bytes, alignment);
+      if (ptr != nullptr)
+      {
+        return ptr;
+      }
+    }
+    std::size_t size = bytes + alignment - 1;
+    m_chunks.emplace_back(size > m_chunkSize ? size : m_chunkSize);
+    m_offset = 0;
+    return bump(m_chunks.back(), bytes, alignment);
+  }
+
+  /**
+   * Individual blocks are not released, so that blocks can be deallocated
+   * in any order. Their memory is reclaimed by rewind() or reset().
+   */
+  void deallocate(void*, std::size_t)
+  { }
+
+  /**
+   * Returns the current position of the arena.
+   */
+  marker mark() const
+  {
+    return marker{m_current, m_offset};
+  }
+
+  /**
+   * Releases all the blocks allocated after the given marker was obtained.
+   * Any object still living in those blocks must have been destroyed,
+   * e.g, the SYCL buffers using them must have gone out of scope.
+   */
+  void rewind(marker m)
+  {
+    m_current = m.m_chunk;
+    m_offset = m.m_offset;
+  }
+
+  /**
+   * Releases all the blocks of the arena, keeping its chunks.
+   */
+  void reset()
+  {
+    rewind(marker{0, 0});
+  }
+
+  /**
+   * Releases all the blocks of the arena and frees its chunks.
+   */
+  void release()
+  {
+    m_chunks.clear();
+    reset();
+  }
+
+  /**
+   * Returns the total size in bytes of the chunks owned by the arena.
+   */
+  std::size_t capacity() const
+  {
+    std::size_t total = 0;
+    for (const auto& c : m_chunks)
+    {
+      total += c.m_size;
+    }
+    return total;
+  }
+
+  /**
+   * Returns the number of chunks owned by the arena.
+   */
+  std::size_t num_chunks() const
+  {
+    return m_chunks.size();
+  }
+
+  private:
+
+  /* Block of memory from which allocations are served
+   */
+  struct chunk
+  {
+    std::unique_ptr<char[]> m_data;
+    std::size_t m_size;
+
+    explicit chunk(std::size_t size) : m_data{new char[size]}, m_size{size}
+    { }
+  };
+
+  /* Allocates from the given chunk, starting at the current offset.
+   * Returns nullptr if the block does not fit in the chunk.
+   */
+  void* bump(chunk& c, std::size_t bytes, std::size_t alignment)
+  {
+    auto base = reinterpret_cast<std::uintptr_t>(c.m_data.get());
+    auto start = (base + m_offset + alignment - 1) & ~(alignment - 1);
+    if (start - base > c.m_size || bytes > c.m_size - (start - base))
+    {
+      return nullptr;
+    }
+    m_offset = start - base + bytes;
+    return reinterpret_cast<void*>(start);
+  }
+
+  std::size_t m_chunkSize;
+  std::vector<chunk> m_chunks;
+  /* Chunk that serves the allocations and first free byte in it
+   */
+  std::size_t m_current;
+  std::size_t m_offset;
+};
+
+/**
+ * arena_allocator
+ *  Standard allocator that obtains its memory from an arena, and can be
+ *  used as the allocator of SYCL buffers.
+ *  Every block is aligned to at least Alignment bytes.
+ *  The arena is not owned by the allocator and must outlive all the
+ *  containers and buffers using it. A default constructed allocator has no
+ *  arena, and obtains aligned blocks from the global operator new and
+ *  delete instead.
+ */
+template <class T, std::size_t Alignment = alignof(std::max_align_t)>
+class arena_allocator
+{
+  public:
+
+  using value_type = T;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using reference = T&;
+  using const_reference = const T&;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+
+  template <class U>
+  struct rebind
+  {
+    using other = arena_allocator<U, Alignment>;
+  };
+
+  static constexpr std::size_t alignment =
+      (Alignment > alignof(T)) ? Alignment : alignof(T);
+
+  static_assert((alignment & (alignment - 1)) == 0,
+                "The alignment must be a power of two");
+
+  arena_allocator() noexcept : m_arena{nullptr}
+  { }
+
+  explicit arena_allocator(arena& a) noexcept : m_arena{&a}
+  { }
+
+  template <class U>
+  arena_allocator(const arena_allocator<U, Alignment>& other) noexcept
+    : m_arena{other.get_arena()}
+  { }
+
+  /**
+   * Returns storage for n objects of type T.
+   * \throws std::bad_array_new_length if the size in bytes overflows
+   * \throws std::bad_alloc if the storage cannot be allocated
+   */
+  pointer allocate(size_type n, const void* = nullptr)
+  {
+    if (n > max_size())
+    {
+      throw std::bad_array_new_length();
+    }
+    if (m_arena == nullptr)
+    {
+      return static_cast<pointer>(aligned_new(n * sizeof(T)));
+    }
+    return static_cast<pointer>(m_arena->allocate(n * sizeof(T), alignment));
+  }
+
+  void deallocate(pointer p, size_type n)
+  {
+    if (m_arena == nullptr)
+    {
+      aligned_delete(p);
+    }
+    else
+    {
+      m_arena->deallocate(p, n * sizeof(T));
+    }
+  }
+
+  size_type max_size() const noexcept
+  {
+    return std::numeric_limits<size_type>::max() / sizeof(T);
+  }
+
+  template <class U, class... Args>
+  void construct(U* p, Args&&... args)
+  {
+    ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+
+  template <class U>
+  void destroy(U* p)
+  {
+    p->~U();
+  }
+
+  arena* get_arena() const noexcept
+  {
+    return m_arena;
+  }
+
+  private:
+
+  /* Allocates an aligned block from the global operator new. The block
+   * is over-allocated so that it can be aligned, and the address returned
+   * by operator new is stored right before the aligned block.
+   */
+  static void* aligned_new(std::size_t bytes)
+  {
+    const std::size_t padding = alignment - 1 + sizeof(void*);
+    if (bytes > std::numeric_limits<std::size_t>::max() - padding)
+    {
+      throw std::bad_alloc();
+    }
+    void* raw = ::operator new(bytes + padding);
+    auto start = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+    auto addr = (start + alignment - 1) & ~(alignment - 1);
+    reinterpret_cast<void**>(addr)[-1] = raw;
+    return reinterpret_cast<void*>(addr);
+  }
+
+  /* Releases a block returned by aligned_new
+   */
+  static void aligned_delete(void* ptr)
+  {
+    ::operator delete(static_cast<void**>(ptr)[-1]);
+  }
+
+  arena* m_arena;
+};
+
+template <class T, std::size_t Alignment>
+constexpr std::size_t arena_allocator<T, Alignment>::alignment;
+
+template <class T1, class T2, std::size_t Alignment>
+bool operator==(const arena_allocator<T1, Alignment>& lhs,
+                const arena_allocator<T2, Alignment>& rhs) noexcept
+{
+  return lhs.get_arena() == rhs.get_arena();
+}
+
+template <class T1, class T2, std::size_t Alignment>
+bool operator!=(const arena_allocator<T1, Alignment>& lhs,
+                const arena_allocator<T2, Alignment>& rhs) noexcept
+{
+  return !(lhs == rhs);
+}
+
+#endif  // INCLUDE_ARENA_ALLOCATOR_HPP
@@ -0,0 +1,232 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  concurrent_stack_allocator.hpp
+ *
+ *  Description:
+ *    Thread-safe variant of the stack allocator, that can be shared by
+ *    threads creating SYCL buffers concurrently.
+ *
+ **************************************************************************/
+
+#ifndef INCLUDE_CONCURRENT_STACK_ALLOCATOR_HPP
+#define INCLUDE_CONCURRENT_STACK_ALLOCATOR_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+
+/**
+ * concurrent_stack
+ *  Fixed-size block of memory from which any number of threads allocate
+ *  by atomically bumping an offset. Every allocation is rounded up to a
+ *  multiple of Alignment, so all the blocks keep that alignment.
+ *  Blocks are not released individually: reset() releases all of them at
+ *  once, and must only be called when none of them is in use.
+ */
+template <std::size_t Alignment = alignof(std::max_align_t)>
+class concurrent_stack {
+  static_assert((Alignment & (Alignment - 1)) == 0,
+                "The alignment must be a power of two");
+
+ public:
+  static constexpr std::size_t alignment = Alignment;
+
+  /**
+   * Allocates the given number of bytes of storage.
+   */
+  explicit concurrent_stack(std::size_t capacity)
+      : m_storage{new char[capacity + Alignment - 1]},
+        m_begin{align(m_storage.get())},
+        m_capacity{capacity},
+        m_offset{0} {}
+
+  concurrent_stack(const concurrent_stack&) = delete;
+  concurrent_stack& operator=(const concurrent_stack&) = delete;
+
+  /**
+   * Returns a block of the given size, or nullptr if the remaining
+   * storage is too small for it. A failed request leaves the stack
+   * unchanged, so smaller requests may still succeed afterwards.
+   */
+  void* allocate(std::size_t bytes) {
+    // Also rejects the sizes whose rounding would overflow
+    if (bytes > m_capacity) {
+      return nullptr;
+    }
+    std::size_t size = (bytes + Alignment - 1) & ~(Alignment - 1);
+    std::size_t offset = m_offset.load(std::memory_order_relaxed);
+    do {
+      if (size > m_capacity - offset) {
+        return nullptr;
+      }
+    } while (!m_offset.compare_exchange_weak(offset, offset + size,
+                                             std::memory_order_relaxed));
+    return m_begin + offset;
+  }
+
+  /**
+   * Whether the given pointer points to the storage of the stack.
+   */
+  bool owns(const void* p) const {
+    auto ptr = static_cast<const char*>(p);
+    return !std::less<const char*>()(ptr, m_begin) &&
+           std::less<const char*>()(ptr, m_begin + m_capacity);
+  }
+
+  /**
+   * Releases all the blocks of the stack.
+   */
+  void reset() { m_offset.store(0, std::memory_order_relaxed); }
+
+  /**
+   * Number of bytes handed out since the last reset.
+   */
+  std::size_t used() const { return m_offset.load(std::memory_order_relaxed); }
+
+  std::size_t capacity() const { return m_capacity; }
+
+ private:
+  static char* align(char* ptr) {
+    auto addr = reinterpret_cast<std::uintptr_t>(ptr);
+    return reinterpret_cast<char*>((addr + Alignment - 1) & ~(Alignment - 1));
+  }
+
+  std::unique_ptr<char[]> m_storage;
+  char* m_begin;
+  std::size_t m_capacity;
+  std::atomic<std::size_t> m_offset;
+};
+
+template <std::size_t Alignment>
+constexpr std::size_t concurrent_stack<Alignment>::alignment;
+
+/**
+ * concurrent_stack_allocator
+ *  Standard allocator that obtains its memory from a concurrent_stack, and
+ *  falls back to the wrapped allocator when the stack is exhausted.
+ *  Unlike stack_allocator, all the copies of an allocator share the same
+ *  stack, and it can be used from several threads at the same time.
+ *  Deallocating a block of the stack does nothing; its memory is reclaimed
+ *  when the stack is reset.
+ */
+template <class T, std::size_t Alignment = alignof(std::max_align_t),
+          class Allocator = std::allocator<T>>
+class concurrent_stack_allocator {
+  static_assert(alignof(T) <= Alignment,
+                "The stack alignment is too small for the type");
+
+ public:
+  using value_type = T;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using reference = T&;
+  using const_reference = const T&;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using stack_type = concurrent_stack<Alignment>;
+  using allocator_type = Allocator;
+
+  template <class U>
+  struct rebind {
+    using other = concurrent_stack_allocator<
+        U, Alignment,
+        typename std::allocator_traits<Allocator>::template rebind_alloc<U>>;
+  };
+
+  /**
+   * A default constructed allocator has no stack, and always uses the
+   * wrapped allocator.
+   */
+  concurrent_stack_allocator(const allocator_type& alloc = allocator_type())
+      : m_allocator(alloc), m_stack{nullptr} {}
+
+  explicit concurrent_stack_allocator(
+      stack_type& stack, const allocator_type& alloc = allocator_type())
+      : m_allocator(alloc), m_stack{&stack} {}
+
+  template <class U, class OtherAllocator>
+  concurrent_stack_allocator(
+      const concurrent_stack_allocator<U, Alignment, OtherAllocator>& other)
+      : m_allocator(other.get_allocator()), m_stack{other.get_stack()} {}
+
+  pointer allocate(size_type n, const void* = nullptr) {
+    if (n > max_size()) {
+      throw std::bad_array_new_length();
+    }
+    if (m_stack != nullptr) {
+      void* ptr = m_stack->allocate(n * sizeof(T));
+      if (ptr != nullptr) {
+        return static_cast<pointer>(ptr);
+      }
+    }
+    return std::allocator_traits<Allocator>::allocate(m_allocator, n);
+  }
+
+  void deallocate(pointer p, size_type n) {
+    if (m_stack == nullptr || !m_stack->owns(p)) {
+      std::allocator_traits<Allocator>::deallocate(m_allocator, p, n);
+    }
+  }
+
+  size_type max_size() const noexcept {
+    return std::allocator_traits<Allocator>::max_size(m_allocator);
+  }
+
+  template <class U, class... Args>
+  void construct(U* p, Args&&... args) {
+    ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+
+  template <class U>
+  void destroy(U* p) {
+    p->~U();
+  }
+
+  stack_type* get_stack() const noexcept { return m_stack; }
+
+  allocator_type get_allocator() const { return m_allocator; }
+
+ private:
+  allocator_type m_allocator;
+  stack_type* m_stack;
+};
+
+template <class T1, class T2, std::size_t Alignment, class Allocator1,
+          class Allocator2>
+bool operator==(
+    const concurrent_stack_allocator<T1, Alignment, Allocator1>& lhs,
+    const concurrent_stack_allocator<T2, Alignment, Allocator2>& rhs) {
+  return lhs.get_stack() == rhs.get_stack();
+}
+
+template <class T1, class T2, std::size_t Alignment, class Allocator1,
+          class Allocator2>
+bool operator!=(
+    const concurrent_stack_allocator<T1, Alignment, Allocator1>& lhs,
+    const concurrent_stack_allocator<T2, Alignment, Allocator2>& rhs) {
+  return !(lhs == rhs);
+}
+
+#endif  // INCLUDE_CONCURRENT_STACK_ALLOCATOR_HPP
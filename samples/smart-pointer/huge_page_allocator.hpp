@@ -0,0 +1,245 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  huge_page_allocator.hpp
+ *
+ *  Description:
+ *    Allocator that serves large requests from 2 MB huge pages, to reduce
+ *    the TLB misses when accessing large SYCL buffers on the host.
+ *
+ **************************************************************************/
+
+#ifndef INCLUDE_HUGE_PAGE_ALLOCATOR_HPP
+#define INCLUDE_HUGE_PAGE_ALLOCATOR_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/mman.h>
+
+/* Flags that request huge pages of page_size bytes, rather than of the
+ * default huge page size of the system, which can be 1GB */
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_2MB)
+#define HUGE_PAGES_MAP_FLAGS (MAP_HUGETLB | MAP_HUGE_2MB)
+#elif defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+#define HUGE_PAGES_MAP_FLAGS (MAP_HUGETLB | (21 << MAP_HUGE_SHIFT))
+#endif
+#endif  // __linux__
+
+namespace huge_pages {
+
+/* Size of the huge pages requested to the system
+ */
+const std::size_t page_size = std::size_t(1) << 21;
+
+/* Rounds the given size up to a whole number of huge pages
+ */
+inline std::size_t round_up(std::size_t bytes) {
+  return (bytes + page_size - 1) & ~(page_size - 1);
+}
+
+#ifdef __linux__
+/**
+ * Maps the given number of bytes, aligned to a huge page, trying in order:
+ *  - Explicit 2MB huge pages (MAP_HUGETLB), when the system has reserved
+ *    them. Every allocation tries them again, since the pool may have been
+ *    exhausted only temporarily.
+ *  - Regular pages marked as candidates for transparent huge pages.
+ * Returns nullptr if the memory cannot be mapped.
+ * \throws std::bad_alloc if the size, rounded up and with the extra page
+ *         used for alignment, does not fit in a size_t
+ */
+inline void* map(std::size_t bytes) {
+  const int prot = PROT_READ | PROT_WRITE;
+  const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  if (bytes > std::numeric_limits<std::size_t>::max() - 2 * page_size) {
+    throw std::bad_alloc();
+  }
+  std::size_t size = round_up(bytes);
+
+#ifdef HUGE_PAGES_MAP_FLAGS
+  // Only a kernel that does not support 2MB huge pages turns them off for
+  // good, other failures (e.g, an exhausted pool) are retried next time
+  static std::atomic<bool> hugetlbSupported{true};
+  if (hugetlbSupported.load(std::memory_order_relaxed)) {
+    void* ptr = mmap(nullptr, size, prot, flags | HUGE_PAGES_MAP_FLAGS, -1, 0);
+    if (ptr != MAP_FAILED) {
+      return ptr;
+    }
+    // A zero-length mapping fails with EINVAL whatever the page size
+    if (size != 0 && (errno == EINVAL || errno == ENOSYS)) {
+      hugetlbSupported.store(false, std::memory_order_relaxed);
+    }
+  }
+#endif  // HUGE_PAGES_MAP_FLAGS
+
+  // Map an extra page so that the start can be aligned to a huge page,
+  // and return the unused head and tail to the system
+  void* raw = mmap(nullptr, size + page_size, prot, flags, -1, 0);
+  if (raw == MAP_FAILED) {
+    return nullptr;
+  }
+  auto rawAddr = reinterpret_cast<std::uintptr_t>(raw);
+  auto addr = (rawAddr + page_size - 1) & ~(page_size - 1);
+  std::size_t head = addr - rawAddr;
+  if (head > 0) {
+    munmap(raw, head);
+  }
+  munmap(reinterpret_cast<void*>(addr + size), page_size - head);
+
+#ifdef MADV_HUGEPAGE
+  // Failing to obtain transparent huge pages is not an error, the memory
+  // is still usable with regular pages
+  madvise(reinterpret_cast<void*>(addr), size, MADV_HUGEPAGE);
+#endif  // MADV_HUGEPAGE
+  return reinterpret_cast<void*>(addr);
+}
+
+/**
+ * Unmaps memory returned by map for the same number of bytes.
+ */
+inline void unmap(void* ptr, std::size_t bytes) { munmap(ptr, round_up(bytes)); }
+#endif  // __linux__
+
+}  // huge_pages
+
+/**
+ * huge_page_allocator
+ *  Standard allocator that serves requests of at least Threshold bytes
+ *  from huge pages, and smaller ones from the wrapped allocator.
+ *  It can be used as the allocator of SYCL buffers, e.g, for the host
+ *  storage of large matrices. If the system has no huge pages available,
+ *  large requests are served from regular pages.
+ *  Huge pages are only requested on Linux, other systems always use the
+ *  wrapped allocator.
+ */
+template <class T, std::size_t Threshold = huge_pages::page_size,
+          class Allocator = std::allocator<T>>
+class huge_page_allocator {
+ public:
+  using value_type = T;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using reference = T&;
+  using const_reference = const T&;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using allocator_type = Allocator;
+
+  template <class U>
+  struct rebind {
+    using other = huge_page_allocator<
+        U, Threshold,
+        typename std::allocator_traits<Allocator>::template rebind_alloc<U>>;
+  };
+
+  huge_page_allocator(const allocator_type& alloc = allocator_type())
+      : m_allocator(alloc) {}
+
+  template <class U, class OtherAllocator>
+  huge_page_allocator(
+      const huge_page_allocator<U, Threshold, OtherAllocator>& other)
+      : m_allocator(other.get_allocator()) {}
+
+  /**
+   * Whether a request of n elements is served from huge pages.
+   */
+  static bool uses_huge_pages(size_type n) {
+#ifdef __linux__
+    // Same as n * sizeof(T) >= Threshold, without overflowing
+    return n >= (Threshold + sizeof(T) - 1) / sizeof(T);
+#else
+    static_cast<void>(n);
+    return false;
+#endif  // __linux__
+  }
+
+  /**
+   * \throws std::bad_array_new_length if the size in bytes overflows
+   * \throws std::bad_alloc if the memory cannot be obtained
+   */
+  pointer allocate(size_type n, const void* = nullptr) {
+    if (n > max_size()) {
+      throw std::bad_array_new_length();
+    }
+#ifdef __linux__
+    if (uses_huge_pages(n)) {
+      void* ptr = huge_pages::map(n * sizeof(T));
+      if (ptr == nullptr) {
+        throw std::bad_alloc();
+      }
+      return static_cast<pointer>(ptr);
+    }
+#endif  // __linux__
+    return std::allocator_traits<Allocator>::allocate(m_allocator, n);
+  }
+
+  void deallocate(pointer p, size_type n) {
+#ifdef __linux__
+    if (uses_huge_pages(n)) {
+      huge_pages::unmap(p, n * sizeof(T));
+      return;
+    }
+#endif  // __linux__
+    std::allocator_traits<Allocator>::deallocate(m_allocator, p, n);
+  }
+
+  size_type max_size() const noexcept {
+    return std::allocator_traits<Allocator>::max_size(m_allocator);
+  }
+
+  template <class U, class... Args>
+  void construct(U* p, Args&&... args) {
+    ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+
+  template <class U>
+  void destroy(U* p) {
+    p->~U();
+  }
+
+  allocator_type get_allocator() const { return m_allocator; }
+
+ private:
+  allocator_type m_allocator;
+};
+
+template <class T1, class T2, std::size_t Threshold, class Allocator1,
+          class Allocator2>
+bool operator==(const huge_page_allocator<T1, Threshold, Allocator1>&,
+                const huge_page_allocator<T2, Threshold, Allocator2>&) {
+  return true;
+}
+
+template <class T1, class T2, std::size_t Threshold, class Allocator1,
+          class Allocator2>
+bool operator!=(const huge_page_allocator<T1, Threshold, Allocator1>& lhs,
+                const huge_page_allocator<T2, Threshold, Allocator2>& rhs) {
+  return !(lhs == rhs);
+}
+
+#endif  // INCLUDE_HUGE_PAGE_ALLOCATOR_HPP
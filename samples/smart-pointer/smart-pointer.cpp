@@ -29,6 +29,8 @@
 
 // Custom stack allocator
 #include "stack_allocator.hpp"
+// Custom arena allocator
+#include "arena_allocator.hpp"
 
 using namespace cl::sycl;
 
@@ -92,6 +94,10 @@ int main() {
   {
     /* Custom allocators can be used - here we use a stack_allocator from
      * https://github.com/charles-salvia/charles/blob/master/stack_allocator.hpp
+     * Unlike the original, blocks of its internal buffer that are not
+     * released in LIFO order are not released at all, so their space leaks
+     * until the internal buffer goes away. Such deallocations can be
+     * counted with stack_allocator::set_stats().
      */
     {
       buffer<int, 1, stack_allocator<int, nElems>> buf{range<1>{nElems}};
@@ -162,5 +168,55 @@ int main() {
      * used in concert no data copy happens (i.e., it has already happened. */
   }
 
+  {
+    /* An arena hands out host memory by bumping a pointer, and releases
+     * it all at once when rewound to a marker. Buffers created and
+     * destroyed every frame then reuse the same host storage, with no
+     * allocation after the first frame. */
+    arena frameArena;
+    using arena_alloc_t = arena_allocator<int, 64>;
+    for (int frame = 0; frame < 3; frame++) {
+      auto frameStart = frameArena.mark();
+      {
+        buffer<int, 1, arena_alloc_t> buf{range<1>{nElems},
+                                          arena_alloc_t{frameArena}};
+        buf.set_final_data(p);
+
+        myQueue.submit([&](handler& cgh) {
+          auto ptr = buf.get_access<access::mode::discard_write>(cgh);
+          cgh.parallel_for<class kernel3>(range<1>(nElems),
+                                          [=](item<1> itemID) {
+            ptr[itemID.get_linear_id()] = (int) (itemID.get_linear_id());
+          });
+        });
+      }
+      /* The buffer has been destroyed, so its storage can be reused. */
+      frameArena.rewind(frameStart);
+
+      int sum = 0;
+      for (unsigned int i = 0; i < nElems; i++) {
+        sum += p.get()[i];
+      }
+
+      if (sum != 66) {
+        correct = false;
+      }
+    }
+
+    /* Without an arena the allocator falls back to operator new, still
+     * honouring the alignment, and sizes that overflow are rejected. */
+    arena_alloc_t heapAlloc;
+    int* block = heapAlloc.allocate(nElems);
+    if (reinterpret_cast<std::uintptr_t>(block) % arena_alloc_t::alignment) {
+      correct = false;
+    }
+    heapAlloc.deallocate(block, nElems);
+    try {
+      heapAlloc.allocate(heapAlloc.max_size() + 1);
+      correct = false;
+    } catch (const std::bad_array_new_length&) {
+    }
+  }
+
   return correct ? 0 : 1;
 }
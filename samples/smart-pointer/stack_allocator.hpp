@@ -39,6 +39,30 @@
 #define NOEXCEPT noexcept
 #endif
 
+// Allocation statistics of a stack_allocator, shared by all its copies.
+// Counting is enabled by passing an instance to set_stats().
+//
+struct stack_allocator_stats
+{
+  // Allocations served from the internal buffer
+  std::size_t arena_allocations = 0;
+  std::size_t arena_bytes = 0;
+  // Allocations served by the wrapped allocator
+  std::size_t fallback_allocations = 0;
+  std::size_t fallback_bytes = 0;
+  // Largest number of bytes of the internal buffer in use at once
+  std::size_t high_water_mark = 0;
+  // Deallocations of the internal buffer not in LIFO order, and the bytes
+  // they did not release
+  std::size_t misordered_deallocations = 0;
+  std::size_t misordered_bytes = 0;
+
+  void reset()
+  {
+    *this = stack_allocator_stats();
+  }
+};
+
 template <class T, std::size_t N, class Allocator = std::allocator<T>>
 class stack_allocator
 {
@@ -58,18 +82,19 @@ class stack_allocator
   public:
 
   explicit stack_allocator(const allocator_type& alloc = allocator_type()) 
-    : m_allocator(alloc), m_begin(nullptr), m_end(nullptr), m_stack_pointer(nullptr)
+    : m_allocator(alloc), m_begin(nullptr), m_end(nullptr), m_stack_pointer(nullptr),
+      m_stats(nullptr)
   { }
 
   explicit stack_allocator(pointer buffer, const allocator_type& alloc = allocator_type())
     : m_allocator(alloc), m_begin(buffer), m_end(buffer + N), 
-      m_stack_pointer(buffer)
+      m_stack_pointer(buffer), m_stats(nullptr)
   { }
 
   template <class U>
   stack_allocator(const stack_allocator<U, N, Allocator>& other)
     : m_allocator(other.m_allocator), m_begin(other.m_begin), m_end(other.m_end),
-      m_stack_pointer(other.m_stack_pointer)
+      m_stack_pointer(other.m_stack_pointer), m_stats(other.m_stats)
   { }
 
   CONSTEXPR static size_type capacity()
@@ -83,21 +108,62 @@ class stack_allocator
     {
       pointer result = m_stack_pointer;
       m_stack_pointer += n;
+      if (m_stats)
+      {
+        m_stats->arena_allocations++;
+        m_stats->arena_bytes += n * sizeof(T);
+        std::size_t in_use = std::distance(m_begin, m_stack_pointer) * sizeof(T);
+        if (in_use > m_stats->high_water_mark)
+        {
+          m_stats->high_water_mark = in_use;
+        }
+      }
       return result;
     }
 
+    if (m_stats)
+    {
+      m_stats->fallback_allocations++;
+      m_stats->fallback_bytes += n * sizeof(T);
+    }
     return m_allocator.allocate(n, hint);
   }
 
+  // Blocks of the internal buffer must be released in LIFO order. Only the
+  // block at the top of the stack is released: any other block is ignored
+  // rather than corrupting the stack, and its space is never reused: it
+  // leaks until the internal buffer goes away. Such deallocations are
+  // counted in the misordered_deallocations and misordered_bytes statistics.
   void deallocate(pointer p, size_type n)
   {
     if (pointer_to_internal_buffer(p))
     {
-      m_stack_pointer -= n;
+      if (p + n == m_stack_pointer)
+      {
+        m_stack_pointer -= n;
+      }
+      else if (m_stats)
+      {
+        m_stats->misordered_deallocations++;
+        m_stats->misordered_bytes += n * sizeof(T);
+      }
     }
     else m_allocator.deallocate(p, n);  
   }
 
+  // Starts recording the allocation statistics in the given object, or
+  // stops recording them if it is null. Copies made afterwards record in
+  // the same object.
+  void set_stats(stack_allocator_stats* stats) NOEXCEPT
+  {
+    m_stats = stats;
+  }
+
+  stack_allocator_stats* stats() const NOEXCEPT
+  {
+    return m_stats;
+  }
+
   size_type max_size() const NOEXCEPT
   {
     return m_allocator.max_size();
@@ -154,6 +220,10 @@ class stack_allocator
   pointer m_begin;
   pointer m_end;
   pointer m_stack_pointer;
+  stack_allocator_stats* m_stats;
+
+  template <class U, std::size_t M, class A>
+  friend class stack_allocator;
 };
 
 template <class T1, std::size_t N, class Allocator, class T2>
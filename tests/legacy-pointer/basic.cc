@@ -29,6 +29,7 @@
 
 #include <CL/sycl.hpp>
 #include <iostream>
+#include <vector>
 
 #include "legacy-pointer/legacy_pointer.hpp"
 
@@ -139,3 +140,96 @@ TEST(pointer_mapper, two_buffers) {
     ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
   }
 }
+
+TEST(pointer_mapper, many_buffers) {
+  {
+    // Spread the buffers over several chunks of the buffer table
+    const size_t numBuffers = 1000;
+    ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
+    std::vector<void *> ptrs(numBuffers);
+    for (size_t i = 0; i < numBuffers; i++) {
+      ptrs[i] = legacy::malloc((i + 1) * sizeof(int));
+      ASSERT_FALSE(legacy::PointerMapper::is_nullptr(ptrs[i]));
+    }
+    ASSERT_EQ(legacy::getPointerMapper().count(), numBuffers);
+
+    // Every pointer retrieves its own buffer
+    for (size_t i = 0; i < numBuffers; i++) {
+      buffer_id bId = legacy::getPointerMapper().get_buffer_id(ptrs[i]);
+      buffer_t b = legacy::getPointerMapper().get_buffer(bId);
+      ASSERT_EQ(b.get_count(), (i + 1) * sizeof(int));
+    }
+
+    // Free every other buffer, the rest must still be reachable
+    for (size_t i = 0; i < numBuffers; i += 2) {
+      legacy::free(ptrs[i]);
+    }
+    ASSERT_EQ(legacy::getPointerMapper().count(), numBuffers / 2);
+    for (size_t i = 1; i < numBuffers; i += 2) {
+      buffer_id bId = legacy::getPointerMapper().get_buffer_id(ptrs[i]);
+      buffer_t b = legacy::getPointerMapper().get_buffer(bId);
+      ASSERT_EQ(b.get_count(), (i + 1) * sizeof(int));
+    }
+
+    legacy::clear();
+    ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
+  }
+}
+
+TEST(pointer_mapper, id_recycling) {
+  {
+    // A mapper of its own, so that no buffer of another test holds an id
+    legacy::PointerMapper pMap;
+    // Churn well past the number of available buffer ids
+    const size_t numLive = 16;
+    const size_t numIterations = 3 * (1UL << 16);
+
+    std::vector<void *> live(numLive);
+    for (auto &ptr : live) {
+      ptr = pMap.add_pointer(buffer_t(cl::sycl::range<1>{sizeof(int)}));
+    }
+    for (size_t i = 0; i < numIterations; i++) {
+      auto &victim = live[i % numLive];
+      buffer_id freedId = pMap.get_buffer_id(victim);
+      pMap.remove_pointer(victim);
+      victim = pMap.add_pointer(buffer_t(cl::sycl::range<1>{sizeof(int)}));
+      ASSERT_FALSE(legacy::PointerMapper::is_nullptr(victim));
+      // The most recently freed id is reused
+      ASSERT_EQ(pMap.get_buffer_id(victim), freedId);
+    }
+    ASSERT_EQ(pMap.count(), numLive);
+
+    // Ids never grow beyond the number of buffers alive at the same time
+    for (auto ptr : live) {
+      ASSERT_LE(pMap.get_buffer_id(ptr), numLive);
+      pMap.remove_pointer(ptr);
+    }
+    ASSERT_EQ(pMap.count(), 0u);
+  }
+}
+
+TEST(pointer_mapper, exhausted_ids) {
+  {
+    legacy::PointerMapper pMap;
+    const auto maxBuffers = legacy::PointerMapper::MAX_NUMBER_BUFFERS;
+    std::vector<void *> ptrs(maxBuffers);
+    for (auto &ptr : ptrs) {
+      ptr = pMap.add_pointer(buffer_t(cl::sycl::range<1>{1}));
+      ASSERT_FALSE(legacy::PointerMapper::is_nullptr(ptr));
+    }
+    ASSERT_EQ(pMap.count(), maxBuffers);
+
+    // No ids left
+    void *overflow = pMap.add_pointer(buffer_t(cl::sycl::range<1>{1}));
+    ASSERT_TRUE(legacy::PointerMapper::is_nullptr(overflow));
+    ASSERT_EQ(pMap.count(), maxBuffers);
+
+    // Freeing one buffer makes its id available again
+    pMap.remove_pointer(ptrs[42]);
+    void *reused = pMap.add_pointer(buffer_t(cl::sycl::range<1>{1}));
+    ASSERT_EQ(reused, ptrs[42]);
+
+    pMap.clear();
+    ASSERT_EQ(pMap.count(), 0u);
+  }
+}
@@ -0,0 +1,185 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *   bridge.cc
+ *
+ *  Description:
+ *   Tests of the exchange of buffers between legacy and virtual pointers
+ *
+ **************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <CL/sycl.hpp>
+
+#include "legacy-pointer/vptr_bridge.hpp"
+
+using sycl_acc_target = cl::sycl::access::target;
+const sycl_acc_target sycl_acc_host = sycl_acc_target::host_buffer;
+
+using sycl_acc_mode = cl::sycl::access::mode;
+const sycl_acc_mode sycl_acc_rw = sycl_acc_mode::read_write;
+
+using namespace codeplay;
+
+using buffer_t = legacy::PointerMapper::buffer_t;
+
+const size_t SIZE = 100;
+
+/* Writes value into the given element of the float array of a legacy
+ * pointer. */
+void write_legacy(void *ptr, size_t i, float value) {
+  auto &lMap = legacy::getPointerMapper();
+  buffer_t b = lMap.get_buffer(lMap.get_buffer_id(ptr));
+  auto hostAcc = b.get_access<sycl_acc_rw, sycl_acc_host>();
+  float *fPtr = reinterpret_cast<float *>(&*hostAcc.get_pointer());
+  fPtr[i] = value;
+}
+
+/* Reads the given element of the float array of a legacy pointer. */
+float read_legacy(void *ptr, size_t i) {
+  auto &lMap = legacy::getPointerMapper();
+  buffer_t b = lMap.get_buffer(lMap.get_buffer_id(ptr));
+  auto hostAcc = b.get_access<sycl_acc_rw, sycl_acc_host>();
+  return reinterpret_cast<float *>(&*hostAcc.get_pointer())[i];
+}
+
+/* Writes value into the given element of the float array of a virtual
+ * pointer. */
+void write_vptr(legacy::vptr_mapper_t &vMap, void *ptr, size_t i,
+                float value) {
+  auto hostAcc = vMap.get_access<sycl_acc_rw, sycl_acc_host>(ptr);
+  float *fPtr = reinterpret_cast<float *>(&*hostAcc.get_pointer());
+  fPtr[i] = value;
+}
+
+/* Reads the given element of the float array of a virtual pointer. */
+float read_vptr(legacy::vptr_mapper_t &vMap, void *ptr, size_t i) {
+  auto hostAcc = vMap.get_access<sycl_acc_rw, sycl_acc_host>(ptr);
+  return reinterpret_cast<float *>(&*hostAcc.get_pointer())[i];
+}
+
+TEST(bridge, share_with_vptr) {
+  legacy::vptr_mapper_t vMap;
+  ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
+
+  float *lPtr = static_cast<float *>(legacy::malloc(SIZE * sizeof(float)));
+  ASSERT_NE(lPtr, nullptr);
+  write_legacy(lPtr, 3, 1.0f);
+
+  void *vPtr = legacy::share_with_vptr(lPtr + 3, vMap);
+  ASSERT_EQ(vMap.count(), 1u);
+  ASSERT_EQ(legacy::getPointerMapper().count(), 1u);
+  ASSERT_EQ(vMap.get_offset(vPtr), 3 * sizeof(float));
+  ASSERT_EQ(vMap.get_buffer(vPtr).get_count(), SIZE * sizeof(float));
+
+  // Both pointers see the writes of the other one
+  ASSERT_EQ(read_vptr(vMap, vPtr, 3), 1.0f);
+  write_vptr(vMap, vPtr, 4, 2.0f);
+  ASSERT_EQ(read_legacy(lPtr, 4), 2.0f);
+
+  // The virtual pointer outlives the legacy one
+  legacy::free(lPtr);
+  ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
+  ASSERT_EQ(read_vptr(vMap, vPtr, 4), 2.0f);
+
+  cl::sycl::codeplay::SYCLfree(vPtr, vMap);
+  ASSERT_EQ(vMap.count(), 0u);
+}
+
+TEST(bridge, share_from_vptr) {
+  legacy::vptr_mapper_t vMap;
+  ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
+
+  float *vPtr = static_cast<float *>(
+      cl::sycl::codeplay::SYCLmalloc(SIZE * sizeof(float), vMap));
+  write_vptr(vMap, vPtr, 5, 1.0f);
+
+  void *lPtr = legacy::share_from_vptr(vPtr + 5, vMap);
+  ASSERT_NE(lPtr, nullptr);
+  ASSERT_EQ(legacy::getPointerMapper().count(), 1u);
+  ASSERT_EQ(vMap.count(), 1u);
+  ASSERT_EQ(legacy::PointerMapper::get_offset(lPtr), 5 * sizeof(float));
+
+  ASSERT_EQ(read_legacy(lPtr, 5), 1.0f);
+  write_legacy(lPtr, 6, 2.0f);
+  ASSERT_EQ(read_vptr(vMap, vPtr, 6), 2.0f);
+
+  // The legacy pointer outlives the virtual one
+  cl::sycl::codeplay::SYCLfree(vPtr, vMap);
+  ASSERT_EQ(vMap.count(), 0u);
+  ASSERT_EQ(read_legacy(lPtr, 6), 2.0f);
+
+  legacy::free(lPtr);
+  ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
+}
+
+TEST(bridge, move_to_vptr) {
+  legacy::vptr_mapper_t vMap;
+
+  float *lPtr = static_cast<float *>(legacy::malloc(SIZE * sizeof(float)));
+  write_legacy(lPtr, 0, 3.0f);
+
+  void *vPtr = legacy::move_to_vptr(lPtr, vMap);
+  ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
+  ASSERT_EQ(vMap.count(), 1u);
+  ASSERT_EQ(read_vptr(vMap, vPtr, 0), 3.0f);
+
+  cl::sycl::codeplay::SYCLfree(vPtr, vMap);
+}
+
+TEST(bridge, move_from_vptr) {
+  legacy::vptr_mapper_t vMap;
+
+  float *vPtr = static_cast<float *>(
+      cl::sycl::codeplay::SYCLmalloc(SIZE * sizeof(float), vMap));
+  write_vptr(vMap, vPtr, 0, 3.0f);
+
+  void *lPtr = legacy::move_from_vptr(vPtr, vMap);
+  ASSERT_NE(lPtr, nullptr);
+  ASSERT_EQ(vMap.count(), 0u);
+  ASSERT_EQ(legacy::getPointerMapper().count(), 1u);
+  ASSERT_EQ(read_legacy(lPtr, 0), 3.0f);
+
+  legacy::free(lPtr);
+}
+
+TEST(bridge, device_access) {
+  legacy::vptr_mapper_t vMap;
+
+  void *lPtr = legacy::malloc(SIZE);
+  void *vPtr = legacy::share_with_vptr(lPtr, vMap);
+
+  cl::sycl::queue q;
+  q.submit([&](cl::sycl::handler &h) {
+    auto acc = vMap.get_access<sycl_acc_rw>(vPtr, h);
+    h.single_task<class bridge_device_access>([=]() { acc[0] = 42; });
+  });
+
+  {
+    auto &lMap = legacy::getPointerMapper();
+    buffer_t b = lMap.get_buffer(lMap.get_buffer_id(lPtr));
+    auto hostAcc = b.get_access<sycl_acc_rw, sycl_acc_host>();
+    ASSERT_EQ(hostAcc[0], 42);
+  }
+
+  cl::sycl::codeplay::SYCLfree(vPtr, vMap);
+  legacy::free(lPtr);
+}
@@ -0,0 +1,150 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *   layout.cc
+ *
+ *  Description:
+ *   Tests of the buffer id / offset split presets of the pointer mapper
+ *
+ **************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <CL/sycl.hpp>
+#include <vector>
+
+#include "legacy-pointer/legacy_pointer.hpp"
+
+using sycl_acc_target = cl::sycl::access::target;
+const sycl_acc_target sycl_acc_host = sycl_acc_target::host_buffer;
+
+using sycl_acc_mode = cl::sycl::access::mode;
+const sycl_acc_mode sycl_acc_rw = sycl_acc_mode::read_write;
+
+using namespace codeplay;
+
+template <typename PointerMapperT>
+class pointer_layout : public ::testing::Test {};
+
+using layouts = ::testing::Types<legacy::PointerMapper16_48,
+                                 legacy::PointerMapper24_40,
+                                 legacy::PointerMapper32_32>;
+TYPED_TEST_CASE(pointer_layout, layouts);
+
+TYPED_TEST(pointer_layout, constants) {
+  using mapper_t = TypeParam;
+  using base_ptr_t = typename mapper_t::base_ptr_t;
+
+  ASSERT_EQ(mapper_t::BUFFER_ID_BITSIZE + mapper_t::OFFSET_BITSIZE,
+            mapper_t::ADDRESS_BITS);
+  ASSERT_EQ(mapper_t::MAX_NUMBER_BUFFERS,
+            (base_ptr_t(1) << mapper_t::BUFFER_ID_BITSIZE) - 1);
+  ASSERT_EQ(mapper_t::MAX_OFFSET,
+            (base_ptr_t(1) << mapper_t::OFFSET_BITSIZE) - 1);
+  ASSERT_GE(sizeof(typename mapper_t::buffer_id) * 8,
+            mapper_t::BUFFER_ID_BITSIZE);
+}
+
+TYPED_TEST(pointer_layout, encode_decode) {
+  using mapper_t = TypeParam;
+  using base_ptr_t = typename mapper_t::base_ptr_t;
+  using buffer_id = typename mapper_t::buffer_id;
+
+  // The decoding is usable in constant expressions
+  static_assert(mapper_t::get_buffer_id(mapper_t::MAX_OFFSET) == 0,
+                "The offset bits must not leak into the buffer id");
+  static_assert(mapper_t::get_offset(base_ptr_t(1)
+                                     << mapper_t::OFFSET_BITSIZE) == 0,
+                "The buffer id bits must not leak into the offset");
+
+  const std::vector<base_ptr_t> ids = {1, 2, 0xFF, mapper_t::MAX_NUMBER_BUFFERS};
+  const std::vector<base_ptr_t> offsets = {0, 1, 0xFFFF,
+                                           mapper_t::MAX_OFFSET};
+  for (auto id : ids) {
+    for (auto offset : offsets) {
+      base_ptr_t ptr = (id << mapper_t::OFFSET_BITSIZE) | offset;
+      ASSERT_EQ(mapper_t::get_buffer_id(ptr), static_cast<buffer_id>(id));
+      ASSERT_EQ(static_cast<base_ptr_t>(mapper_t::get_offset(ptr)), offset);
+      ASSERT_FALSE(mapper_t::is_nullptr(reinterpret_cast<void *>(ptr)));
+    }
+  }
+}
+
+TYPED_TEST(pointer_layout, malloc_offset) {
+  using mapper_t = TypeParam;
+  using buffer_t = typename mapper_t::buffer_t;
+
+  auto &pMap = legacy::getPointerMapper<mapper_t>();
+  ASSERT_EQ(pMap.count(), 0u);
+
+  const size_t size = 100;
+  void *ptr = legacy::malloc<mapper_t>(size * sizeof(float));
+  ASSERT_NE(ptr, nullptr);
+  ASSERT_EQ(pMap.count(), 1u);
+  ASSERT_EQ(mapper_t::get_offset(ptr), 0);
+
+  void *ptrOff = static_cast<float *>(ptr) + 10;
+  ASSERT_EQ(mapper_t::get_offset(ptrOff), 10 * sizeof(float));
+  ASSERT_EQ(mapper_t::get_buffer_id(ptrOff), mapper_t::get_buffer_id(ptr));
+
+  buffer_t b = pMap.get_buffer(mapper_t::get_buffer_id(ptrOff));
+  {
+    auto hostAcc = b.template get_access<sycl_acc_rw, sycl_acc_host>();
+    ASSERT_EQ(hostAcc.get_count(), size * sizeof(float));
+  }
+
+  legacy::free<mapper_t>(ptr);
+  ASSERT_EQ(pMap.count(), 0u);
+}
+
+/* The 24-bit preset holds more buffers than the default one.
+ */
+TEST(pointer_layout_24_40, many_buffers) {
+  using mapper_t = legacy::PointerMapper24_40;
+
+  const size_t numBuffers = legacy::PointerMapper::MAX_NUMBER_BUFFERS + 16;
+  std::vector<void *> ptrs(numBuffers);
+  for (auto &ptr : ptrs) {
+    ptr = legacy::malloc<mapper_t>(sizeof(int));
+    ASSERT_NE(ptr, nullptr);
+  }
+  auto &pMap = legacy::getPointerMapper<mapper_t>();
+  ASSERT_EQ(pMap.count(), numBuffers);
+  ASSERT_GT(mapper_t::get_buffer_id(ptrs.back()),
+            legacy::PointerMapper::MAX_NUMBER_BUFFERS);
+
+  for (auto ptr : ptrs) {
+    legacy::free<mapper_t>(ptr);
+  }
+  ASSERT_EQ(pMap.count(), 0u);
+}
+
+/* The default layout functions can be passed by address.
+ */
+TEST(pointer_layout_default, function_pointers) {
+  void *(*mallocFn)(size_t) = &legacy::malloc;
+  void (*freeFn)(void *) = &legacy::free;
+
+  void *ptr = mallocFn(sizeof(int));
+  ASSERT_NE(ptr, nullptr);
+  ASSERT_EQ(legacy::getPointerMapper().count(), 1u);
+  freeFn(ptr);
+  ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
+}
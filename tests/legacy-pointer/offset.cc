@@ -172,3 +172,54 @@ TEST(offset, 2d_indexing) {
     ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
   }
 }
+
+TEST(offset, ranged_access) {
+  {
+    const size_t SIZE = 100;
+    const size_t SLICE_BEGIN = 10;
+    const size_t SLICE_SIZE = 5;
+    ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
+    float * myPtr = static_cast<float *>(
+                        legacy::malloc(SIZE * sizeof(float)));
+    ASSERT_NE(myPtr, nullptr);
+
+    // Initialize the whole buffer
+    buffer_t b = legacy::getPointerMapper().get_buffer(
+        legacy::getPointerMapper().get_buffer_id(myPtr));
+    {
+      auto hostAcc = b.get_access<sycl_acc_rw, sycl_acc_host>();
+      for (size_t i = 0; i < SIZE * sizeof(float); i++) {
+        hostAcc[i] = 0;
+      }
+    }
+
+    float * slicePtr = myPtr + SLICE_BEGIN;
+    const size_t offset = SLICE_BEGIN * sizeof(float);
+    const size_t count = SLICE_SIZE * sizeof(float);
+
+    cl::sycl::queue q;
+    q.submit([&](cl::sycl::handler& h) {
+        auto accB = legacy::getPointerMapper().get_access<sycl_acc_rw>(
+            slicePtr, count, h);
+        ASSERT_EQ(accB.get_offset()[0], offset);
+        ASSERT_EQ(accB.get_range()[0], count);
+        h.single_task<class ranged_access>([=]() {
+              auto first = accB.get_offset()[0];
+              for (size_t i = 0; i < accB.get_range()[0]; i++) {
+                accB[first + i] = 1;
+              }
+            });
+        });
+
+    // Only the bytes of the slice have been written
+    {
+      auto hostAcc = b.get_access<sycl_acc_rw, sycl_acc_host>();
+      for (size_t i = 0; i < SIZE * sizeof(float); i++) {
+        bool inSlice = (i >= offset) && (i < offset + count);
+        ASSERT_EQ(hostAcc[i], inSlice ? 1 : 0);
+      }
+    }
+    legacy::free(myPtr);
+    ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
+  }
+}
@@ -0,0 +1,248 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  threads.cc
+ *
+ *  Description:
+ *   Tests of the thread-local legacy pointer mappers
+ *
+ **************************************************************************/
+
+#define CODEPLAY_LEGACY_THREAD_LOCAL
+
+#include "gtest/gtest.h"
+
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "legacy-pointer/legacy_pointer.hpp"
+
+using namespace codeplay;
+
+using buffer_id = legacy::PointerMapper::buffer_id;
+using buffer_t = legacy::PointerMapper::buffer_t;
+
+const size_t numThreads = 8;
+
+TEST(threads, separate_id_ranges) {
+  std::vector<std::vector<void *>> ptrs(numThreads);
+  std::vector<std::thread> threads;
+  std::atomic<size_t> numAllocated{0};
+  for (size_t t = 0; t < numThreads; t++) {
+    threads.emplace_back([&ptrs, &numAllocated, t]() {
+      // Each thread gets a range of ids of its own
+      ptrs[t].push_back(legacy::malloc(sizeof(int)));
+      ptrs[t].push_back(legacy::malloc(sizeof(int)));
+      EXPECT_EQ(legacy::getPointerMapper().count(), 2u);
+      for (auto ptr : ptrs[t]) {
+        EXPECT_FALSE(legacy::PointerMapper::is_nullptr(ptr));
+      }
+      // Keep all the threads alive until every one has allocated, otherwise
+      // the mapper of an exited thread is adopted by the next one
+      ++numAllocated;
+      while (numAllocated.load() < numThreads) {
+        std::this_thread::yield();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  auto &pMap = legacy::getPointerMapper();
+  const auto rangeBits = legacy::PointerMapper::ID_RANGE_BITSIZE;
+  for (size_t t = 0; t < numThreads; t++) {
+    buffer_id first = pMap.get_buffer_id(ptrs[t][0]);
+    buffer_id second = pMap.get_buffer_id(ptrs[t][1]);
+    ASSERT_EQ(first >> rangeBits, second >> rangeBits);
+    for (size_t u = 0; u < t; u++) {
+      ASSERT_NE(pMap.get_buffer_id(ptrs[u][0]), first);
+    }
+    // The buffers outlive the threads that allocated them
+    ASSERT_EQ(pMap.get_buffer(first).get_count(), sizeof(int));
+  }
+
+  // Free from a thread that did not allocate them
+  for (auto &threadPtrs : ptrs) {
+    for (auto ptr : threadPtrs) {
+      legacy::free(ptr);
+    }
+  }
+  ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
+}
+
+TEST(threads, cross_thread_free) {
+  const size_t numPtrs = 1000;
+  std::vector<void *> ptrs(numPtrs);
+  for (size_t i = 0; i < numPtrs; i++) {
+    ptrs[i] = legacy::malloc((i + 1) * sizeof(float));
+  }
+  ASSERT_EQ(legacy::getPointerMapper().count(), numPtrs);
+
+  // Other threads look up and free the buffers of this one
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads; t++) {
+    threads.emplace_back([&ptrs, t]() {
+      auto &pMap = legacy::getPointerMapper();
+      for (size_t i = t; i < ptrs.size(); i += numThreads) {
+        buffer_t b = pMap.get_buffer(pMap.get_buffer_id(ptrs[i]));
+        ASSERT_EQ(b.get_count(), (i + 1) * sizeof(float));
+        legacy::free(ptrs[i]);
+      }
+      ASSERT_EQ(pMap.count(), 0u);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
+
+  // The ids freed by other threads are reused by this one
+  std::vector<void *> reused(numPtrs);
+  for (auto &ptr : reused) {
+    ptr = legacy::malloc(sizeof(float));
+  }
+  auto &pMap = legacy::getPointerMapper();
+  for (size_t i = 0; i < numPtrs; i++) {
+    ASSERT_NE(std::find(ptrs.begin(), ptrs.end(), reused[i]), ptrs.end());
+  }
+  for (auto ptr : reused) {
+    legacy::free(ptr);
+  }
+  ASSERT_EQ(pMap.count(), 0u);
+}
+
+TEST(threads, concurrent_churn) {
+  const size_t numIterations = 20000;
+  const size_t numLive = 32;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads; t++) {
+    threads.emplace_back([=]() {
+      auto &pMap = legacy::getPointerMapper();
+      std::vector<void *> live(numLive);
+      for (size_t i = 0; i < numIterations; i++) {
+        auto &ptr = live[i % numLive];
+        if (ptr != nullptr) {
+          legacy::free(ptr);
+        }
+        ptr = legacy::malloc(t + 1);
+        ASSERT_FALSE(legacy::PointerMapper::is_nullptr(ptr));
+        buffer_t b = pMap.get_buffer(pMap.get_buffer_id(ptr));
+        ASSERT_EQ(b.get_count(), t + 1);
+      }
+      for (auto ptr : live) {
+        legacy::free(ptr);
+      }
+      ASSERT_EQ(pMap.count(), 0u);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+TEST(threads, adopt_abandoned_mapper) {
+  void *ptr = nullptr;
+  legacy::PointerMapper *abandoned = nullptr;
+  std::thread([&]() {
+    ptr = legacy::malloc(sizeof(int));
+    abandoned = &legacy::getPointerMapper();
+  }).join();
+
+  // The buffer is still alive after the thread exits
+  auto &pMap = legacy::getPointerMapper();
+  ASSERT_EQ(pMap.get_buffer(pMap.get_buffer_id(ptr)).get_count(),
+            sizeof(int));
+
+  // A new thread takes over the mapper left behind
+  legacy::PointerMapper *adopted = nullptr;
+  std::thread([&]() {
+    adopted = &legacy::getPointerMapper();
+    ASSERT_EQ(adopted->count(), 1u);
+    legacy::free(ptr);
+    ASSERT_EQ(adopted->count(), 0u);
+  }).join();
+  ASSERT_EQ(adopted, abandoned);
+}
+
+TEST(threads, exit_and_start_during_lookups) {
+  const size_t numPtrs = 64;
+  const size_t numRounds = 200;
+  std::vector<void *> ptrs(numPtrs);
+  for (size_t i = 0; i < numPtrs; i++) {
+    ptrs[i] = legacy::malloc(i + 1);
+  }
+
+  // Readers keep looking up the buffers of this thread
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (size_t t = 0; t < numThreads / 2; t++) {
+    readers.emplace_back([&]() {
+      auto &pMap = legacy::getPointerMapper();
+      while (!done.load()) {
+        for (size_t i = 0; i < numPtrs; i++) {
+          buffer_t b = pMap.get_buffer(pMap.get_buffer_id(ptrs[i]));
+          ASSERT_EQ(b.get_count(), i + 1);
+        }
+      }
+    });
+  }
+
+  // Meanwhile, short-lived threads start and exit. Every other one leaves
+  // a buffer behind, which the next one frees, destroying the abandoned
+  // mapper unless it adopted it.
+  std::vector<std::thread> spawners;
+  for (size_t t = 0; t < numThreads / 2; t++) {
+    spawners.emplace_back([=]() {
+      void *leftover = nullptr;
+      for (size_t r = 0; r < numRounds; r++) {
+        std::thread([&leftover, r]() {
+          auto &pMap = legacy::getPointerMapper();
+          if (leftover != nullptr) {
+            buffer_t b = pMap.get_buffer(pMap.get_buffer_id(leftover));
+            ASSERT_EQ(b.get_count(), 1u);
+            legacy::free(leftover);
+          }
+          legacy::free(legacy::malloc(2));
+          leftover = (r % 2 == 0) ? legacy::malloc(1) : nullptr;
+        }).join();
+      }
+      if (leftover != nullptr) {
+        legacy::free(leftover);
+      }
+    });
+  }
+  for (auto &thread : spawners) {
+    thread.join();
+  }
+  done.store(true);
+  for (auto &thread : readers) {
+    thread.join();
+  }
+
+  for (auto ptr : ptrs) {
+    legacy::free(ptr);
+  }
+  ASSERT_EQ(legacy::getPointerMapper().count(), 0u);
+}
@@ -0,0 +1,189 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *   arena.cc
+ *
+ *  Description:
+ *   Tests of the arena allocator
+ *
+ **************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <CL/sycl.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "arena_allocator.hpp"
+
+using sycl_acc_mode = cl::sycl::access::mode;
+const sycl_acc_mode sycl_acc_rw = sycl_acc_mode::read_write;
+
+bool is_aligned(const void* ptr, std::size_t alignment) {
+  return reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0;
+}
+
+TEST(arena, alignment) {
+  arena a(1024);
+  for (std::size_t alignment = 1; alignment <= 256; alignment *= 2) {
+    // Misalign the arena before each allocation
+    a.allocate(1, 1);
+    void* ptr = a.allocate(3, alignment);
+    ASSERT_TRUE(is_aligned(ptr, alignment));
+  }
+  ASSERT_THROW(a.allocate(8, 3), std::invalid_argument);
+
+  arena_allocator<char, 64> alloc(a);
+  for (int i = 0; i < 8; i++) {
+    ASSERT_TRUE(is_aligned(alloc.allocate(5), 64));
+  }
+  ASSERT_EQ(arena_allocator<double>::alignment, alignof(std::max_align_t));
+}
+
+TEST(arena, chained_chunks) {
+  const std::size_t chunkSize = 256;
+  arena a(chunkSize);
+  ASSERT_EQ(a.num_chunks(), 0u);
+
+  std::vector<char*> blocks;
+  for (int i = 0; i < 10; i++) {
+    blocks.push_back(static_cast<char*>(a.allocate(100, 1)));
+  }
+  // Two blocks fit in each chunk
+  ASSERT_EQ(a.num_chunks(), 5u);
+  ASSERT_EQ(a.capacity(), 5 * chunkSize);
+
+  // The blocks do not overlap
+  for (std::size_t i = 0; i < blocks.size(); i++) {
+    std::fill(blocks[i], blocks[i] + 100, static_cast<char>(i));
+  }
+  for (std::size_t i = 0; i < blocks.size(); i++) {
+    for (int j = 0; j < 100; j++) {
+      ASSERT_EQ(blocks[i][j], static_cast<char>(i));
+    }
+  }
+
+  // Requests larger than a chunk get a chunk of their own
+  void* big = a.allocate(4 * chunkSize, 64);
+  ASSERT_TRUE(is_aligned(big, 64));
+  ASSERT_EQ(a.num_chunks(), 6u);
+}
+
+TEST(arena, mark_rewind) {
+  arena a(256);
+  a.allocate(16, 8);
+  auto m = a.mark();
+
+  void* first = a.allocate(200, 8);
+  a.allocate(200, 8);
+  a.allocate(200, 8);
+  ASSERT_EQ(a.num_chunks(), 3u);
+
+  // Rewinding gives back the same memory, without new chunks
+  a.rewind(m);
+  ASSERT_EQ(a.allocate(200, 8), first);
+  a.allocate(200, 8);
+  a.allocate(200, 8);
+  ASSERT_EQ(a.num_chunks(), 3u);
+
+  a.reset();
+  a.allocate(16, 8);
+  ASSERT_EQ(a.allocate(200, 8), first);
+
+  a.release();
+  ASSERT_EQ(a.num_chunks(), 0u);
+  ASSERT_EQ(a.capacity(), 0u);
+}
+
+TEST(arena, out_of_order_deallocate) {
+  arena a(1024);
+  arena_allocator<int> alloc(a);
+  int* x = alloc.allocate(16);
+  int* y = alloc.allocate(16);
+  int* z = alloc.allocate(16);
+  for (int i = 0; i < 16; i++) {
+    y[i] = i;
+  }
+
+  // Deallocations are ignored until the arena is rewound
+  alloc.deallocate(x, 16);
+  alloc.deallocate(z, 16);
+  int* w = alloc.allocate(16);
+  ASSERT_NE(w, x);
+  ASSERT_NE(w, z);
+  for (int i = 0; i < 16; i++) {
+    w[i] = -1;
+    ASSERT_EQ(y[i], i);
+  }
+  alloc.deallocate(y, 16);
+  alloc.deallocate(w, 16);
+
+  a.reset();
+  ASSERT_EQ(alloc.allocate(16), x);
+}
+
+TEST(arena, std_container) {
+  arena a(1024);
+  auto m = a.mark();
+  {
+    std::vector<int, arena_allocator<int>> v{arena_allocator<int>(a)};
+    for (int i = 0; i < 1000; i++) {
+      v.push_back(i);
+    }
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_EQ(v[i], i);
+    }
+  }
+  a.rewind(m);
+
+  // Allocators using the same arena are equal
+  arena b;
+  ASSERT_TRUE(arena_allocator<int>(a) == arena_allocator<char>(a));
+  ASSERT_TRUE(arena_allocator<int>(a) != arena_allocator<int>(b));
+}
+
+TEST(arena, sycl_buffer) {
+  using allocator_t = arena_allocator<float, 64>;
+  const size_t nElems = 128;
+  arena a(1 << 16);
+  cl::sycl::queue q;
+
+  // Per-frame buffers reuse the same host storage
+  for (int frame = 0; frame < 4; frame++) {
+    auto m = a.mark();
+    {
+      cl::sycl::buffer<float, 1, allocator_t> buf(cl::sycl::range<1>{nElems},
+                                                   allocator_t(a));
+      q.submit([&](cl::sycl::handler& h) {
+        auto acc = buf.get_access<sycl_acc_rw>(h);
+        h.parallel_for<class arena_fill>(
+            cl::sycl::range<1>{nElems},
+            [=](cl::sycl::item<1> i) { acc[i] = i.get_linear_id() + frame; });
+      });
+      auto hostAcc =
+          buf.get_access<sycl_acc_rw, cl::sycl::access::target::host_buffer>();
+      for (size_t i = 0; i < nElems; i++) {
+        ASSERT_EQ(hostAcc[i], i + frame);
+      }
+    }
+    a.rewind(m);
+  }
+  ASSERT_EQ(a.num_chunks(), 1u);
+}
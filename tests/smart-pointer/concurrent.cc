@@ -0,0 +1,178 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *   concurrent.cc
+ *
+ *  Description:
+ *   Tests of the thread-safe stack allocator
+ *
+ **************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <CL/sycl.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "concurrent_stack_allocator.hpp"
+
+using sycl_acc_mode = cl::sycl::access::mode;
+const sycl_acc_mode sycl_acc_rw = sycl_acc_mode::read_write;
+
+const unsigned numThreads = 8;
+
+TEST(concurrent_stack, allocate_reset) {
+  concurrent_stack<64> stack(1024);
+  concurrent_stack_allocator<char, 64> alloc(stack);
+
+  char* a = alloc.allocate(1);
+  char* b = alloc.allocate(100);
+  ASSERT_EQ(reinterpret_cast<std::uintptr_t>(a) % 64, 0u);
+  ASSERT_EQ(b, a + 64);
+  ASSERT_TRUE(stack.owns(a));
+  ASSERT_EQ(stack.used(), 64u + 128u);
+
+  // Deallocation does not release the block
+  alloc.deallocate(a, 1);
+  ASSERT_NE(alloc.allocate(1), a);
+
+  // Requests that do not fit use the wrapped allocator
+  char* big = alloc.allocate(2048);
+  ASSERT_FALSE(stack.owns(big));
+  alloc.deallocate(big, 2048);
+
+  stack.reset();
+  ASSERT_EQ(stack.used(), 0u);
+  ASSERT_EQ(alloc.allocate(1), a);
+}
+
+TEST(concurrent_stack, failed_requests) {
+  concurrent_stack<64> stack(1024);
+  char* a = static_cast<char*>(stack.allocate(128));
+  ASSERT_NE(a, nullptr);
+
+  // Failures, including sizes whose rounding overflows, leave the stack as
+  // it was
+  ASSERT_EQ(stack.allocate(SIZE_MAX - 63), nullptr);
+  ASSERT_EQ(stack.allocate(SIZE_MAX - 10), nullptr);
+  ASSERT_EQ(stack.allocate(1024), nullptr);
+  ASSERT_EQ(stack.used(), 128u);
+  ASSERT_EQ(stack.allocate(64), a + 128);
+
+  concurrent_stack_allocator<int, 64> alloc(stack);
+  ASSERT_THROW(alloc.allocate(alloc.max_size() + 1), std::bad_array_new_length);
+}
+
+TEST(concurrent_stack, copies_share_the_stack) {
+  concurrent_stack<> stack(1024);
+  concurrent_stack_allocator<int> alloc(stack);
+  concurrent_stack_allocator<double> copy(alloc);
+  ASSERT_TRUE(alloc == copy);
+
+  int* a = alloc.allocate(4);
+  double* b = copy.allocate(4);
+  ASSERT_GE(reinterpret_cast<char*>(b), reinterpret_cast<char*>(a + 4));
+
+  concurrent_stack_allocator<int> noStack;
+  ASSERT_TRUE(alloc != noStack);
+}
+
+TEST(concurrent_stack, threads) {
+  const size_t blocksPerThread = 1000;
+  const size_t blockSize = 24;
+  concurrent_stack<> stack(numThreads * blocksPerThread * 32);
+  concurrent_stack_allocator<std::uint32_t> alloc(stack);
+
+  std::vector<std::vector<std::uint32_t*>> blocks(numThreads);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < numThreads; t++) {
+    threads.emplace_back([&, t]() {
+      auto myAlloc = alloc;
+      for (size_t i = 0; i < blocksPerThread; i++) {
+        auto ptr = myAlloc.allocate(blockSize / sizeof(std::uint32_t));
+        std::fill(ptr, ptr + blockSize / sizeof(std::uint32_t), t);
+        blocks[t].push_back(ptr);
+      }
+    });
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+
+  // Every block was served by the stack, and no two blocks overlap
+  std::vector<std::uint32_t*> all;
+  for (unsigned t = 0; t < numThreads; t++) {
+    for (auto ptr : blocks[t]) {
+      ASSERT_TRUE(stack.owns(ptr));
+      for (size_t i = 0; i < blockSize / sizeof(std::uint32_t); i++) {
+        ASSERT_EQ(ptr[i], t);
+      }
+      all.push_back(ptr);
+    }
+  }
+  std::sort(all.begin(), all.end());
+  for (size_t i = 1; i < all.size(); i++) {
+    ASSERT_GE(reinterpret_cast<char*>(all[i]) -
+                  reinterpret_cast<char*>(all[i - 1]),
+              static_cast<std::ptrdiff_t>(blockSize));
+  }
+  ASSERT_EQ(stack.used(), numThreads * blocksPerThread * 32);
+}
+
+TEST(concurrent_stack, sycl_buffers) {
+  using allocator_t = concurrent_stack_allocator<int>;
+  const size_t nElems = 64;
+  const size_t buffersPerThread = 16;
+  concurrent_stack<> stack(numThreads * buffersPerThread * nElems *
+                           sizeof(int));
+  allocator_t alloc(stack);
+
+  std::vector<int> results(numThreads, 0);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < numThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (size_t b = 0; b < buffersPerThread; b++) {
+        cl::sycl::buffer<int, 1, allocator_t> buf(cl::sycl::range<1>{nElems},
+                                                  alloc);
+        {
+          auto hostAcc = buf.get_access<
+              sycl_acc_rw, cl::sycl::access::target::host_buffer>();
+          for (size_t i = 0; i < nElems; i++) {
+            hostAcc[i] = t;
+          }
+        }
+        auto hostAcc =
+            buf.get_access<sycl_acc_rw, cl::sycl::access::target::host_buffer>();
+        for (size_t i = 0; i < nElems; i++) {
+          results[t] += (hostAcc[i] == static_cast<int>(t));
+        }
+      }
+    });
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+  for (unsigned t = 0; t < numThreads; t++) {
+    ASSERT_EQ(results[t], static_cast<int>(buffersPerThread * nElems));
+  }
+  ASSERT_EQ(stack.used(), stack.capacity());
+}
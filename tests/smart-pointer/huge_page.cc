@@ -0,0 +1,119 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *   huge_page.cc
+ *
+ *  Description:
+ *   Tests of the huge page allocator
+ *
+ **************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <CL/sycl.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "huge_page_allocator.hpp"
+
+using sycl_acc_mode = cl::sycl::access::mode;
+const sycl_acc_mode sycl_acc_rw = sycl_acc_mode::read_write;
+
+TEST(huge_page, small_requests) {
+  huge_page_allocator<float> alloc;
+  ASSERT_FALSE(alloc.uses_huge_pages(16));
+  float* ptr = alloc.allocate(16);
+  ASSERT_NE(ptr, nullptr);
+  for (int i = 0; i < 16; i++) {
+    ptr[i] = i;
+  }
+  alloc.deallocate(ptr, 16);
+}
+
+TEST(huge_page, large_requests) {
+  huge_page_allocator<float> alloc;
+  // Sizes that are not a multiple of the huge page size
+  const size_t nElems = 3 * huge_pages::page_size / sizeof(float) + 5;
+#ifdef __linux__
+  ASSERT_TRUE(alloc.uses_huge_pages(nElems));
+#endif  // __linux__
+  std::vector<float*> ptrs;
+  for (int i = 0; i < 4; i++) {
+    float* ptr = alloc.allocate(nElems);
+    ASSERT_NE(ptr, nullptr);
+#ifdef __linux__
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % huge_pages::page_size,
+              0u);
+#endif  // __linux__
+    ptr[0] = 1.0f;
+    ptr[nElems - 1] = 2.0f;
+    ptrs.push_back(ptr);
+  }
+  for (auto ptr : ptrs) {
+    ASSERT_EQ(ptr[0], 1.0f);
+    ASSERT_EQ(ptr[nElems - 1], 2.0f);
+    alloc.deallocate(ptr, nElems);
+  }
+}
+
+TEST(huge_page, threshold) {
+  huge_page_allocator<char, 4096> alloc;
+  ASSERT_FALSE(alloc.uses_huge_pages(4095));
+#ifdef __linux__
+  ASSERT_TRUE(alloc.uses_huge_pages(4096));
+  // Rebinding keeps the threshold in bytes
+  huge_page_allocator<double, 4096> rebound(alloc);
+  ASSERT_TRUE(rebound.uses_huge_pages(512));
+  ASSERT_FALSE(rebound.uses_huge_pages(511));
+#endif  // __linux__
+}
+
+TEST(huge_page, overflow) {
+  huge_page_allocator<char> alloc;
+  ASSERT_THROW(alloc.allocate(alloc.max_size() + 1), std::bad_array_new_length);
+  huge_page_allocator<double> wide;
+  ASSERT_THROW(wide.allocate(SIZE_MAX / 4), std::bad_array_new_length);
+#ifdef __linux__
+  // Sizes in bytes that overflow are still large requests
+  ASSERT_TRUE(wide.uses_huge_pages(SIZE_MAX));
+  ASSERT_THROW(huge_pages::map(SIZE_MAX - 10), std::bad_alloc);
+#endif  // __linux__
+}
+
+TEST(huge_page, sycl_buffer) {
+  using allocator_t = huge_page_allocator<float>;
+  const size_t nElems = huge_pages::page_size;
+  cl::sycl::queue q;
+  {
+    cl::sycl::buffer<float, 1, allocator_t> buf(cl::sycl::range<1>{nElems},
+                                                allocator_t());
+    q.submit([&](cl::sycl::handler& h) {
+      auto acc = buf.get_access<sycl_acc_rw>(h);
+      h.parallel_for<class huge_page_fill>(
+          cl::sycl::range<1>{nElems},
+          [=](cl::sycl::item<1> i) { acc[i] = i.get_linear_id(); });
+    });
+    auto hostAcc =
+        buf.get_access<sycl_acc_rw, cl::sycl::access::target::host_buffer>();
+    for (size_t i = 0; i < nElems; i += 4099) {
+      ASSERT_EQ(hostAcc[i], static_cast<float>(i));
+    }
+  }
+}
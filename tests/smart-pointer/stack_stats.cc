@@ -0,0 +1,113 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *   stack_stats.cc
+ *
+ *  Description:
+ *   Tests of the allocation statistics of the stack allocator
+ *
+ **************************************************************************/
+
+#include "gtest/gtest.h"
+
+#include <CL/sycl.hpp>
+
+#include "stack_allocator.hpp"
+
+const std::size_t N = 64;
+using allocator_t = stack_allocator<int, N>;
+
+TEST(stack_stats, disabled_by_default) {
+  int storage[N];
+  allocator_t alloc(storage);
+  ASSERT_EQ(alloc.stats(), nullptr);
+  int* p = alloc.allocate(8);
+  alloc.deallocate(p, 8);
+}
+
+TEST(stack_stats, arena_and_fallback) {
+  int storage[N];
+  stack_allocator_stats stats;
+  allocator_t alloc(storage);
+  alloc.set_stats(&stats);
+
+  int* a = alloc.allocate(16);
+  int* b = alloc.allocate(32);
+  ASSERT_EQ(stats.arena_allocations, 2u);
+  ASSERT_EQ(stats.arena_bytes, 48 * sizeof(int));
+  ASSERT_EQ(stats.high_water_mark, 48 * sizeof(int));
+
+  // Does not fit in the remaining 16 elements
+  int* c = alloc.allocate(17);
+  ASSERT_EQ(stats.fallback_allocations, 1u);
+  ASSERT_EQ(stats.fallback_bytes, 17 * sizeof(int));
+  alloc.deallocate(c, 17);
+
+  alloc.deallocate(b, 32);
+  alloc.deallocate(a, 16);
+  ASSERT_EQ(stats.misordered_deallocations, 0u);
+
+  // The high water mark is kept after the deallocations
+  int* d = alloc.allocate(8);
+  ASSERT_EQ(d, storage);
+  ASSERT_EQ(stats.high_water_mark, 48 * sizeof(int));
+  alloc.deallocate(d, 8);
+
+  stats.reset();
+  ASSERT_EQ(stats.arena_allocations, 0u);
+  ASSERT_EQ(stats.high_water_mark, 0u);
+}
+
+TEST(stack_stats, misordered_deallocation) {
+  int storage[N];
+  stack_allocator_stats stats;
+  allocator_t alloc(storage);
+  alloc.set_stats(&stats);
+
+  int* a = alloc.allocate(8);
+  int* b = alloc.allocate(8);
+  b[0] = 42;
+
+  // Releasing a block that is not at the top is counted, and does not
+  // release any memory
+  alloc.deallocate(a, 8);
+  ASSERT_EQ(stats.misordered_deallocations, 1u);
+  ASSERT_EQ(stats.misordered_bytes, 8 * sizeof(int));
+  int* c = alloc.allocate(8);
+  ASSERT_EQ(c, b + 8);
+  ASSERT_EQ(b[0], 42);
+
+  alloc.deallocate(c, 8);
+  alloc.deallocate(b, 8);
+  ASSERT_EQ(stats.misordered_deallocations, 1u);
+}
+
+TEST(stack_stats, shared_by_copies) {
+  int storage[N];
+  stack_allocator_stats stats;
+  allocator_t alloc(storage);
+  alloc.set_stats(&stats);
+
+  allocator_t::rebind<long>::other rebound(alloc);
+  ASSERT_EQ(rebound.stats(), &stats);
+  auto p = rebound.allocate(4);
+  ASSERT_EQ(stats.arena_allocations, 1u);
+  rebound.deallocate(p, 4);
+}
@@ -0,0 +1,148 @@
+/***************************************************************************
+ *
+ *  Copyright (C) 2017 Codeplay Software Limited
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  For your convenience, a copy of the License has been included in this
+ *  repository.
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  Codeplay's ComputeCpp SDK
+ *
+ *  compressed.cc
+ *
+ *  Description:
+ *   Tests for the 32-bit virtual address space of the mapper
+ *
+ **************************************************************************/
+
+#define CODEPLAY_VPTR_32BIT_ADDRESS_SPACE
+
+#include "gtest/gtest.h"
+
+#include <CL/sycl.hpp>
+#include <iostream>
+#include <vector>
+
+#include "vptr/virtual_ptr.hpp"
+
+using sycl_acc_target = cl::sycl::access::target;
+const sycl_acc_target sycl_acc_host = sycl_acc_target::host_buffer;
+const sycl_acc_target sycl_acc_buffer = sycl_acc_target::global_buffer;
+
+using sycl_acc_mode = cl::sycl::access::mode;
+const sycl_acc_mode sycl_acc_rw = sycl_acc_mode::read_write;
+const sycl_acc_mode sycl_acc_r = sycl_acc_mode::read;
+
+using namespace cl::sycl::codeplay;
+
+using compressed_ptr_t = PointerMapper::compressed_ptr_t;
+
+TEST(compressed, pointer_size) {
+  ASSERT_EQ(sizeof(compressed_ptr_t), 4u);
+  ASSERT_EQ(PointerMapper::max_address(), 0xFFFFFFFFu);
+}
+
+TEST(compressed, round_trip) {
+  PointerMapper pMap;
+  float *a = static_cast<float *>(SYCLmalloc(100 * sizeof(float), pMap));
+  float *b = static_cast<float *>(SYCLmalloc(10 * sizeof(float), pMap));
+
+  compressed_ptr_t cA = PointerMapper::compress(a + 5);
+  compressed_ptr_t cB = PointerMapper::compress(b);
+  ASSERT_EQ(static_cast<void *>(PointerMapper::decompress(cA)),
+            static_cast<void *>(a + 5));
+  ASSERT_EQ(static_cast<void *>(PointerMapper::decompress(cB)),
+            static_cast<void *>(b));
+  ASSERT_EQ(pMap.get_offset(PointerMapper::decompress(cA)),
+            5 * sizeof(float));
+
+  SYCLfree(a, pMap);
+  SYCLfree(b, pMap);
+  ASSERT_EQ(pMap.count(), 0u);
+}
+
+TEST(compressed, invalid_base_address) {
+  ASSERT_THROW(PointerMapper pMap(PointerMapper::base_ptr_t(1) << 32),
+               std::invalid_argument);
+}
+
+TEST(compressed, address_space_exhausted) {
+  // Leave room for exactly two pages at the end of the address space
+  const size_t pageSize = 4096;
+  PointerMapper pMap(PointerMapper::max_address() - 2 * pageSize);
+
+  void *first = SYCLmalloc(pageSize, pMap);
+  ASSERT_NE(first, nullptr);
+  ASSERT_THROW(SYCLmalloc(2 * pageSize, pMap), std::out_of_range);
+  ASSERT_EQ(pMap.count(), 1u);
+
+  // The remaining space can still be allocated
+  void *second = SYCLmalloc(pageSize, pMap);
+  ASSERT_NE(second, nullptr);
+  ASSERT_EQ(pMap.count(), 2u);
+
+  // A freed pointer can be reused even if the address space is full
+  SYCLfree(first, pMap);
+  void *reused = SYCLmalloc(pageSize, pMap);
+  ASSERT_EQ(reused, first);
+
+  SYCLfreeAll(pMap);
+  ASSERT_THROW(PointerMapper::compress(PointerMapper::max_address() + 1u),
+               std::out_of_range);
+}
+
+TEST(compressed, pointers_on_device) {
+  const size_t numNodes = 16;
+  PointerMapper pMap;
+  compressed_ptr_t *nodes = static_cast<compressed_ptr_t *>(
+      SYCLmalloc(numNodes * sizeof(compressed_ptr_t), pMap));
+  int *values = static_cast<int *>(SYCLmalloc(numNodes * sizeof(int), pMap));
+
+  // Store a linked list of virtual pointers into the values array,
+  // each node pointing to the previous value
+  {
+    auto hostAcc = pMap.get_access<sycl_acc_rw, sycl_acc_host,
+                                   compressed_ptr_t>(nodes);
+    for (size_t i = 0; i < numNodes; i++) {
+      hostAcc[i] = PointerMapper::compress(values + (numNodes - 1 - i));
+    }
+  }
+
+  // Decoding on the device is a simple subtraction from the base address
+  const compressed_ptr_t base = PointerMapper::compress(values);
+  cl::sycl::queue q;
+  q.submit([&](cl::sycl::handler &h) {
+    auto accNodes =
+        pMap.get_access<sycl_acc_r, sycl_acc_buffer, compressed_ptr_t>(nodes,
+                                                                         h);
+    auto accValues =
+        pMap.get_access<sycl_acc_rw, sycl_acc_buffer, int>(values, h);
+    h.parallel_for<class decode_compressed>(
+        cl::sycl::range<1>{numNodes}, [=](cl::sycl::item<1> item) {
+          auto id = item.get_linear_id();
+          auto target = (accNodes[id] - base) / sizeof(int);
+          accValues[target] = static_cast<int>(id);
+        });
+  });
+
+  {
+    auto hostAcc = pMap.get_access<sycl_acc_r, sycl_acc_host, int>(values);
+    for (size_t i = 0; i < numNodes; i++) {
+      ASSERT_EQ(hostAcc[i], static_cast<int>(numNodes - 1 - i));
+    }
+  }
+
+  SYCLfree(nodes, pMap);
+  SYCLfree(values, pMap);
+  ASSERT_EQ(pMap.count(), 0u);
+}